@@ -30,6 +30,9 @@
   });
 
   const API_HEADERS = { 'Content-Type': 'application/x-www-form-urlencoded' };
+  // Control bodies go out as raw bytes so the firmware parses them into its
+  // fixed form pool instead of allocating String params per request.
+  const CONTROL_HEADERS = { 'Content-Type': 'application/octet-stream' };
   let currentMode = 'wifi';
   let colorInFlight = false;
   let latestPayload = null;
@@ -110,7 +113,7 @@
     try {
       const res = await fetch('/api/mode', {
         method: 'POST',
-        headers: API_HEADERS,
+        headers: CONTROL_HEADERS,
         body: `mode=${encodeURIComponent(mode)}`,
       });
       if (!res.ok) throw new Error('mode failed');
@@ -139,7 +142,7 @@
       try {
         await fetch('/postRGB', {
           method: 'POST',
-          headers: API_HEADERS,
+          headers: CONTROL_HEADERS,
           body,
         });
       } catch (err) {
@@ -194,7 +197,7 @@
     try {
       await fetch('/api/party', {
         method: 'POST',
-        headers: API_HEADERS,
+        headers: CONTROL_HEADERS,
         body: `hz=${hz}`,
       });
     } catch (err) {
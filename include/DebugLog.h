@@ -3,6 +3,7 @@
 
 #include <Arduino.h>
 #include <stdarg.h>
+#include <esp_heap_caps.h>
 
 // Lightweight tagged logger with timestamp (millis) to help trace freezes.
 inline void logStatus(const char *tag, const char *fmt, ...)
@@ -21,4 +22,38 @@ inline void logStatus(const char *tag, const char *fmt, ...)
     Serial.printf("[T+%9lu ms][%s] %s\n", millis(), tag, message);
 }
 
+// Heap figures that expose fragmentation, not just total free bytes.
+struct HeapSnapshot
+{
+    uint32_t freeBytes;
+    uint32_t largestBlock;
+    uint32_t minimumFree;
+    uint32_t allocatedBlocks;
+    uint32_t freeBlocks;
+
+    // 0 = one contiguous free region, approaching 100 = badly fragmented.
+    uint32_t fragmentationPercent() const
+    {
+        if (freeBytes == 0)
+        {
+            return 0;
+        }
+        return 100 - (largestBlock * 100) / freeBytes;
+    }
+};
+
+inline HeapSnapshot captureHeap()
+{
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+
+    HeapSnapshot snap;
+    snap.freeBytes = info.total_free_bytes;
+    snap.largestBlock = info.largest_free_block;
+    snap.minimumFree = info.minimum_free_bytes;
+    snap.allocatedBlocks = info.allocated_blocks;
+    snap.freeBlocks = info.free_blocks;
+    return snap;
+}
+
 #endif
@@ -0,0 +1,179 @@
+#ifndef ADMISSION_H
+#define ADMISSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum class AdmissionPriority : uint8_t {
+    NORMAL,
+    RESERVED, // status and mode changes: may use the reserved slot, never rate limited
+};
+
+enum class AdmissionDecision : uint8_t {
+    ADMIT,
+    RATE_LIMITED, // 429: this client is sending faster than its budget
+    BUSY,         // 503: every request slot it may use is taken
+    LOW_HEAP,     // 503: free heap is below the floor
+};
+
+struct AdmissionStats {
+    uint32_t admitted;
+    uint32_t rateLimited;
+    uint32_t busy;
+    uint32_t lowHeap;
+    uint8_t peakInFlight;
+};
+
+// Decides, on the first callback of each HTTP request, whether the server
+// takes it on. Bounds concurrent requests (AsyncTCP buffers and response
+// objects are what run the heap dry under a burst), keeps the last slot for
+// RESERVED requests so the UI can always read status and switch modes, and
+// gives each client a token bucket. Fixed tables only; nothing allocates.
+class AdmissionControl {
+public:
+    static constexpr size_t MAX_IN_FLIGHT = 5;
+    static constexpr size_t RESERVED_SLOTS = 1;
+    static constexpr size_t MAX_TRACKED = 10;   // in-flight plus rejects awaiting their reply
+    // Rejects never take the entries an admitted request needs, so pending
+    // rejects cannot turn a free request slot into BUSY.
+    static constexpr size_t MAX_TRACKED_REJECTS = MAX_TRACKED - MAX_IN_FLIGHT;
+    static constexpr size_t MAX_CLIENTS = 8;
+    static constexpr uint32_t BUCKET_SIZE = 40;  // requests a client may burst
+    static constexpr uint32_t REFILL_PER_SEC = 25;
+    static constexpr uint32_t HEAP_FLOOR = 24 * 1024;
+    static constexpr unsigned long STALE_MS = 10000; // entries whose disconnect never arrived
+
+    // Repeated calls for the same request return the first decision;
+    // firstSeen tells the caller to hook the request's disconnect. A request
+    // rejected while every reject entry is taken cannot be remembered, so it
+    // is judged again on each callback and counted only on the last one (final).
+    AdmissionDecision check(const void *request, uint32_t client, AdmissionPriority priority,
+                            unsigned long nowMs, uint32_t freeHeap, bool final, bool &firstSeen) {
+        firstSeen = false;
+        Entry *slot = nullptr;
+        size_t inFlight = 0;
+        size_t rejected = 0;
+        for (size_t i = 0; i < MAX_TRACKED; i++) {
+            Entry &entry = entries[i];
+            if (entry.owner != nullptr && nowMs - entry.since > STALE_MS) {
+                entry.owner = nullptr;
+            }
+            if (entry.owner == request) {
+                return entry.decision;
+            }
+            if (entry.owner == nullptr) {
+                slot = slot ? slot : &entry;
+            } else if (entry.decision == AdmissionDecision::ADMIT) {
+                inFlight++;
+            } else {
+                rejected++;
+            }
+        }
+
+        AdmissionDecision decision = AdmissionDecision::ADMIT;
+        const size_t limit = priority == AdmissionPriority::RESERVED ? MAX_IN_FLIGHT : MAX_IN_FLIGHT - RESERVED_SLOTS;
+        const bool rememberReject = slot != nullptr && rejected < MAX_TRACKED_REJECTS;
+        const bool counted = rememberReject || final;
+        if (freeHeap < HEAP_FLOOR) {
+            decision = AdmissionDecision::LOW_HEAP;
+            counters.lowHeap += counted;
+        } else if (inFlight >= limit) {
+            decision = AdmissionDecision::BUSY;
+            counters.busy += counted;
+        } else if (priority == AdmissionPriority::NORMAL && !takeToken(client, nowMs)) {
+            decision = AdmissionDecision::RATE_LIMITED;
+            counters.rateLimited += counted;
+        } else {
+            counters.admitted++;
+            if (inFlight + 1 > counters.peakInFlight) {
+                counters.peakInFlight = static_cast<uint8_t>(inFlight + 1);
+            }
+        }
+
+        if (decision == AdmissionDecision::ADMIT || rememberReject) {
+            slot->owner = request;
+            slot->since = nowMs;
+            slot->decision = decision;
+            firstSeen = true;
+        }
+        return decision;
+    }
+
+    // The request's connection closed; its slot is free again.
+    void finish(const void *request) {
+        for (size_t i = 0; i < MAX_TRACKED; i++) {
+            if (entries[i].owner == request) {
+                entries[i].owner = nullptr;
+            }
+        }
+    }
+
+    static uint32_t retryAfterSeconds(AdmissionDecision decision) {
+        return decision == AdmissionDecision::LOW_HEAP ? 5 : 1;
+    }
+
+    size_t inFlight() const {
+        size_t used = 0;
+        for (size_t i = 0; i < MAX_TRACKED; i++) {
+            if (entries[i].owner != nullptr && entries[i].decision == AdmissionDecision::ADMIT) {
+                used++;
+            }
+        }
+        return used;
+    }
+
+    const AdmissionStats &stats() const {
+        return counters;
+    }
+
+private:
+    struct Entry {
+        const void *owner = nullptr;
+        unsigned long since = 0;
+        AdmissionDecision decision = AdmissionDecision::ADMIT;
+    };
+
+    struct Bucket {
+        uint32_t client = 0;
+        uint32_t milliTokens = 0;
+        unsigned long lastMs = 0;
+    };
+
+    Entry entries[MAX_TRACKED];
+    Bucket buckets[MAX_CLIENTS];
+    AdmissionStats counters = {};
+
+    bool takeToken(uint32_t client, unsigned long nowMs) {
+        Bucket *bucket = nullptr;
+        Bucket *oldest = &buckets[0];
+        for (size_t i = 0; i < MAX_CLIENTS; i++) {
+            if (buckets[i].client == client) {
+                bucket = &buckets[i];
+                break;
+            }
+            if (nowMs - buckets[i].lastMs > nowMs - oldest->lastMs) {
+                oldest = &buckets[i];
+            }
+        }
+        if (!bucket) {
+            // Unknown client: recycle the least recently seen bucket, full.
+            bucket = oldest;
+            bucket->client = client;
+            bucket->milliTokens = BUCKET_SIZE * 1000;
+            bucket->lastMs = nowMs;
+        }
+
+        const uint32_t full = BUCKET_SIZE * 1000;
+        const unsigned long elapsed = nowMs - bucket->lastMs;
+        const uint32_t refill = elapsed >= full / REFILL_PER_SEC ? full : elapsed * REFILL_PER_SEC;
+        bucket->milliTokens = bucket->milliTokens + refill > full ? full : bucket->milliTokens + refill;
+        bucket->lastMs = nowMs;
+        if (bucket->milliTokens < 1000) {
+            return false;
+        }
+        bucket->milliTokens -= 1000;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef FORM_PARSER_H
+#define FORM_PARSER_H
+
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// Zero-allocation parser for the small control bodies we accept
+// ("r=12&g=40&b=255", "mode=party", "hz=1.5"). The body is copied into a
+// fixed buffer and split/decoded in place, so nothing touches the heap.
+class FormFields {
+public:
+    static constexpr size_t MAX_BODY = 128;
+    static constexpr size_t MAX_FIELDS = 8;
+
+    bool parse(const uint8_t *data, size_t len) {
+        count = 0;
+        if (data == nullptr || len == 0 || len >= MAX_BODY) {
+            return false;
+        }
+        memcpy(buffer, data, len);
+        buffer[len] = '\0';
+
+        char *cursor = buffer;
+        while (*cursor != '\0' && count < MAX_FIELDS) {
+            char *pair = cursor;
+            char *amp = strchr(cursor, '&');
+            if (amp) {
+                *amp = '\0';
+                cursor = amp + 1;
+            } else {
+                cursor = pair + strlen(pair);
+            }
+
+            char *eq = strchr(pair, '=');
+            if (!eq || eq == pair) {
+                continue;
+            }
+            *eq = '\0';
+            keys[count] = pair;
+            values[count] = eq + 1;
+            decode(values[count]);
+            count++;
+        }
+        return count > 0;
+    }
+
+    const char *get(const char *key) const {
+        for (size_t i = 0; i < count; i++) {
+            if (strcmp(keys[i], key) == 0) {
+                return values[i];
+            }
+        }
+        return nullptr;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+private:
+    char buffer[MAX_BODY];
+    const char *keys[MAX_FIELDS];
+    char *values[MAX_FIELDS];
+    size_t count = 0;
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    static void decode(char *s) {
+        char *out = s;
+        while (*s) {
+            if (*s == '+') {
+                *out++ = ' ';
+                s++;
+            } else if (*s == '%' && hexValue(s[1]) >= 0 && hexValue(s[2]) >= 0) {
+                *out++ = static_cast<char>((hexValue(s[1]) << 4) | hexValue(s[2]));
+                s += 3;
+            } else {
+                *out++ = *s++;
+            }
+        }
+        *out = '\0';
+    }
+};
+
+// Strict numeric conversions: unlike String::toInt() they reject trailing
+// garbage and empty values instead of silently returning 0.
+inline bool formParseInt(const char *text, int &out) {
+    if (text == nullptr || *text == '\0') {
+        return false;
+    }
+    char *end = nullptr;
+    long value = strtol(text, &end, 10);
+    if (*end != '\0') {
+        return false;
+    }
+    out = static_cast<int>(value);
+    return true;
+}
+
+inline bool formParseFloat(const char *text, float &out) {
+    if (text == nullptr || *text == '\0') {
+        return false;
+    }
+    char *end = nullptr;
+    float value = strtof(text, &end);
+    if (*end != '\0' || isnan(value)) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
+// Fixed pool of parsed bodies keyed by the request that owns them. The body
+// callback claims a slot, the request callback reads and releases it. Slots
+// left behind by aborted requests are reclaimed once they go stale.
+template <size_t N>
+class FormSlotPool {
+public:
+    static constexpr unsigned long STALE_MS = 2000;
+
+    FormFields *claim(const void *owner, unsigned long now) {
+        Slot *chosen = nullptr;
+        for (size_t i = 0; i < N; i++) {
+            Slot &slot = slots[i];
+            if (slot.owner == owner) {
+                chosen = &slot;
+                break;
+            }
+            if (!chosen && (slot.owner == nullptr || now - slot.claimedAt > STALE_MS)) {
+                chosen = &slot;
+            }
+        }
+        if (!chosen) {
+            dropped++;
+            return nullptr;
+        }
+        chosen->owner = owner;
+        chosen->claimedAt = now;
+        return &chosen->fields;
+    }
+
+    FormFields *find(const void *owner) {
+        for (size_t i = 0; i < N; i++) {
+            if (slots[i].owner == owner) {
+                return &slots[i].fields;
+            }
+        }
+        return nullptr;
+    }
+
+    void release(const void *owner) {
+        for (size_t i = 0; i < N; i++) {
+            if (slots[i].owner == owner) {
+                slots[i].owner = nullptr;
+            }
+        }
+    }
+
+    size_t inUse() const {
+        size_t used = 0;
+        for (size_t i = 0; i < N; i++) {
+            if (slots[i].owner != nullptr) {
+                used++;
+            }
+        }
+        return used;
+    }
+
+    uint32_t droppedCount() const {
+        return dropped;
+    }
+
+private:
+    struct Slot {
+        const void *owner = nullptr;
+        unsigned long claimedAt = 0;
+        FormFields fields;
+    };
+
+    Slot slots[N];
+    uint32_t dropped = 0;
+};
+
+#endif
@@ -3,37 +3,60 @@
 
 #include <Arduino.h>
 #include <Preferences.h>
+#include "PwmStage.h"
+#include "Trace.h"
+
+#ifdef ARDUINO
+#include <driver/ledc.h>
+#endif
 
 static constexpr float RED_TRIM = 0.95f;   // Adjust these between 0.0-1.0
 static constexpr float GREEN_TRIM = 1.0f;  // to trim individual colors
-static constexpr float BLUE_TRIM = 0.40f; 
+static constexpr float BLUE_TRIM = 0.40f;
+
+// Number of output channels on this board. The next revision (RGB + white,
+// second zone) builds with -DLAMP_LED_CHANNELS=... and a longer channel map.
+#ifndef LAMP_LED_CHANNELS
+#define LAMP_LED_CHANNELS 3
+#endif
+
+// One row of the board's channel map: which GPIO a logical channel drives,
+// the LEDC channel behind it and its color trim.
+struct LedChannelConfig {
+    uint8_t pin;
+    uint8_t ledcChannel;
+    float trim;
+};
+
+#ifdef ARDUINO
+// All channels share one timer so their hpoints are relative to the same
+// counter; ledcSetup() would have spread them over several timers.
+static constexpr ledc_mode_t LED_SPEED_MODE = LEDC_LOW_SPEED_MODE;
+static constexpr ledc_timer_t LED_TIMER = LEDC_TIMER_0;
+#endif
 
+// N-channel PWM output. Logical channel i is row i of the channel map; the
+// first three are red, green and blue for the RGB helpers. Per-channel state
+// is kept as parallel arrays so each pipeline stage is a plain loop over N.
+template <size_t N>
 class LEDController {
+    static_assert(N >= 1 && N <= 6, "the ESP32-C3 has six LEDC channels");
+
 private:
-    const int redPin;
-    const int greenPin;
-    const int bluePin;
-    const int frequency;
-    const int resolution;
-    const int redChannel;
-    const int greenChannel;
-    const int blueChannel;
-    int currentRed = 0;
-    int currentGreen = 0;
-    int currentBlue = 0;
+    uint8_t pins[N];
+    uint8_t channels[N];
+    float trims[N];
+    int current[N] = {};   // after trim, as last written
+    int requested[N] = {}; // last value asked for, before trim and suppression
+    int outputs[N] = {};   // logical 0-2047 after power limit
+    PwmTiming timing;
+    void (*flushHook)() = nullptr;
     //int updateThreshold = 30;
-    //bool shouldUpdate(int current, int new_value);
 
     static constexpr float LOCKED_POWER_LIMIT = 0.3f;   // 30% power
     static constexpr float UNLOCKED_POWER_LIMIT = 0.6f; // 60% power
     float currentPowerLimit;
     Preferences preferences;
-    
-    void applyPowerLimit(int& red, int& green, int& blue);
-    void loadPowerLimit();
-    void writePWM(int channel, int value);
-    void updatePowerLimitFromPreferences();
-
 
     float updateThreshold = 5; // Initial threshold - no need to change this
     float noiseThreshold = 20; // Max pot noise level should be below this
@@ -41,27 +64,248 @@ private:
     unsigned long lastChangeTime = 0;
     const unsigned long idleTimeThreshold = 7000;
 
+    // Adaptive change suppression for all channels at once. Same result as
+    // checking the channels one after another: a big jump on any channel
+    // makes it and every later channel sensitive and restarts the idle timer.
+    void selectUpdates(const int *target, bool *update) {
+        const unsigned long now = millis();
+        const float idleThreshold = now - lastChangeTime > idleTimeThreshold ? noiseThreshold : updateThreshold;
+        bool bigSeen = false;
+        for (size_t i = 0; i < N; i++) {
+            const int diff = abs(current[i] - target[i]);
+            bigSeen = bigSeen || diff > noiseThreshold;
+            update[i] = diff > (bigSeen ? minThreshold : idleThreshold);
+        }
+        if (bigSeen) {
+            lastChangeTime = now;
+            updateThreshold = minThreshold;
+        } else {
+            updateThreshold = idleThreshold;
+        }
+    }
+
+    void writePWM(size_t index, int value) {
+        value = static_cast<int>(value * currentPowerLimit);
+        outputs[index] = value;
+        traceEvent(TraceEvent::PWM, channels[index], 0, static_cast<uint32_t>(value));
+#ifndef ARDUINO
+        ledcWrite(channels[index], value);
+#endif
+    }
+
+    // Pushes every channel to the hardware at once: with PACKED phases a duty
+    // change on one channel moves the start of the next.
+    void flushPWM() {
+#ifdef ARDUINO
+        uint32_t duty[N];
+        uint32_t hpoint[N];
+        for (size_t i = 0; i < N; i++) {
+            duty[i] = pwmScaleDuty(outputs[i], timing.resolution);
+        }
+        pwmPhasePoints(duty, N, timing.resolution, timing.phase, hpoint);
+        for (size_t i = 0; i < N; i++) {
+            const ledc_channel_t channel = static_cast<ledc_channel_t>(channels[i]);
+            ledc_set_duty_with_hpoint(LED_SPEED_MODE, channel, duty[i], hpoint[i]);
+            ledc_update_duty(LED_SPEED_MODE, channel);
+        }
+#endif
+        if (flushHook) {
+            flushHook();
+        }
+    }
+
+    // Rewrites the held values under a new power limit, so a relock dims the
+    // lamp at once instead of at the next colour change.
+    void setPowerLimit(float limit) {
+        currentPowerLimit = limit;
+        for (size_t i = 0; i < N; i++) {
+            writePWM(i, current[i]);
+        }
+        flushPWM();
+    }
+
+    void attachChannel(size_t index) {
+#ifdef ARDUINO
+        ledc_channel_config_t channelConfig = {};
+        channelConfig.gpio_num = pins[index];
+        channelConfig.speed_mode = LED_SPEED_MODE;
+        channelConfig.channel = static_cast<ledc_channel_t>(channels[index]);
+        channelConfig.timer_sel = LED_TIMER;
+        channelConfig.duty = 0;
+        channelConfig.hpoint = 0;
+        ledc_channel_config(&channelConfig);
+#else
+        ledcSetup(channels[index], timing.frequency, timing.resolution);
+        ledcAttachPin(pins[index], channels[index]);
+#endif
+    }
+
+    void loadTiming() {
+        preferences.begin("led", true);
+        PwmTiming stored = timing;
+        stored.frequency = preferences.getULong("pwmFreq", timing.frequency);
+        stored.resolution = preferences.getUChar("pwmRes", timing.resolution);
+        stored.phase = static_cast<PwmPhaseMode>(preferences.getUChar("pwmPhase", static_cast<uint8_t>(timing.phase)));
+        preferences.end();
+        if (pwmTimingValid(stored)) {
+            timing = stored;
+        }
+    }
+
+    void updatePowerLimitFromPreferences() {
+        preferences.begin("led", false);
+        bool unlocked = preferences.getBool("unlocked", false);
+        currentPowerLimit = unlocked ? UNLOCKED_POWER_LIMIT : LOCKED_POWER_LIMIT;
+        preferences.end();
+        Serial.printf("Power limit updated to: %f\n", currentPowerLimit);
+    }
 
 public:
-    LEDController(
-        int redPin, int greenPin, int bluePin,
-        int redChannel = 0, int greenChannel = 1, int blueChannel = 2,
-        int frequency = 19000, int resolution = 11
-    );
-    void begin();
-    void setPWMDirectly(int red, int green, int blue);
+    explicit LEDController(const LedChannelConfig (&channelMap)[N], int frequency = 19000, int resolution = 11)
+        : timing{static_cast<uint32_t>(frequency), static_cast<uint8_t>(resolution), PwmPhaseMode::STAGGERED},
+          currentPowerLimit(LOCKED_POWER_LIMIT) {
+        for (size_t i = 0; i < N; i++) {
+            pins[i] = channelMap[i].pin;
+            channels[i] = channelMap[i].ledcChannel;
+            trims[i] = channelMap[i].trim;
+        }
+    }
+
+    // Called after every push to the hardware (PowerGovernor times command
+    // latency up to the first one after a wake).
+    void setFlushHook(void (*hook)()) { flushHook = hook; }
+
+    void begin() {
+        loadTiming();
+
+#ifdef ARDUINO
+        ledc_timer_config_t timerConfig = {};
+        timerConfig.speed_mode = LED_SPEED_MODE;
+        timerConfig.duty_resolution = static_cast<ledc_timer_bit_t>(timing.resolution);
+        timerConfig.timer_num = LED_TIMER;
+        timerConfig.freq_hz = timing.frequency;
+        timerConfig.clk_cfg = LEDC_USE_APB_CLK;
+        ledc_timer_config(&timerConfig);
+#endif
+        for (size_t i = 0; i < N; i++) {
+            attachChannel(i);
+        }
+
+        // Initialize all LEDs to off
+        flushPWM();
+
+        updatePowerLimitFromPreferences();
+    }
+
+    // Logical 0-2047 per channel, in channel-map order.
+    void setChannels(const int *values) {
+        int target[N];
+        for (size_t i = 0; i < N; i++) {
+            requested[i] = constrain(values[i], 0, 2047);
+        }
+        for (size_t i = 0; i < N; i++) {
+            target[i] = static_cast<int>(requested[i] * trims[i]);
+        }
+
+        bool update[N];
+        selectUpdates(target, update);
+
+        #ifdef DEBUG_LED
+        if (Serial) {
+            for (size_t i = 0; i < N; i++) {
+                Serial.printf("DEBUG: ch%u -> %d%s\n", channels[i], target[i], update[i] ? "" : " (held)");
+            }
+        }
+        #endif
+
+        bool any = false;
+        for (size_t i = 0; i < N; i++) {
+            if (update[i]) {
+                current[i] = target[i];
+                writePWM(i, target[i]);
+                any = true;
+            }
+        }
+        if (any) {
+            flushPWM();
+        }
+    }
+
+    // RGB helpers for the first three channels; any others are set to 0.
+    void setPWMDirectly(int red, int green, int blue) {
+        static_assert(N >= 3, "RGB helpers need at least three channels");
+        int values[N] = {};
+        values[0] = red;
+        values[1] = green;
+        values[2] = blue;
+        setChannels(values);
+    }
     void getPWMValues(int& red, int& green, int& blue) {
-        red = currentRed;
-        green = currentGreen;
-        blue = currentBlue;
+        red = current[0];
+        green = current[1];
+        blue = current[2];
+    }
+    void getRequestedValues(int& red, int& green, int& blue) {
+        red = requested[0];
+        green = requested[1];
+        blue = requested[2];
+    }
+    bool isDark() const {
+        for (size_t i = 0; i < N; i++) {
+            if (current[i] != 0) {
+                return false;
+            }
+        }
+        return true;
     }
     bool isUnlocked() const { return currentPowerLimit > LOCKED_POWER_LIMIT; }
-    void unlock();
-    void resetToSafeMode();
-    void checkAndUpdatePowerLimit();
 
-    bool shouldUpdate(int current, int new_value);
-    void adjustThreshold(int current, int new_value);
+    // Reprograms frequency, resolution and channel phases on the running
+    // timer, so the change lands within one PWM period without a blackout.
+    // Persisted; returns false if the combination is out of LEDC range.
+    bool setTiming(const PwmTiming &next) {
+        if (!pwmTimingValid(next)) {
+            return false;
+        }
+        timing = next;
+#ifdef ARDUINO
+        // Updates divider and resolution in place; they latch at the next counter
+        // overflow together with the rescaled duties below. ledc_timer_config()
+        // would pause and reset the timer instead.
+        ledc_timer_set(LED_SPEED_MODE, LED_TIMER, pwmDivider(timing), timing.resolution, LEDC_APB_CLK);
+#endif
+        flushPWM();
+
+        preferences.begin("led", false);
+        preferences.putULong("pwmFreq", timing.frequency);
+        preferences.putUChar("pwmRes", timing.resolution);
+        preferences.putUChar("pwmPhase", static_cast<uint8_t>(timing.phase));
+        preferences.end();
+        Serial.printf("PWM timing: %lu Hz, %u bits, %s\n", static_cast<unsigned long>(timing.frequency),
+                      timing.resolution, pwmPhaseName(timing.phase));
+        return true;
+    }
+    PwmTiming getTiming() const { return timing; }
+
+    void unlock() {
+        preferences.begin("led", false);
+        preferences.putBool("unlocked", true);
+        preferences.end();
+        setPowerLimit(UNLOCKED_POWER_LIMIT);
+    }
+
+    void resetToSafeMode() {
+        preferences.begin("led", false);
+        preferences.putBool("unlocked", false);
+        preferences.end();
+        setPowerLimit(LOCKED_POWER_LIMIT);
+    }
+
+    void checkAndUpdatePowerLimit() {
+        updatePowerLimitFromPreferences();
+    }
 };
 
-#endif
\ No newline at end of file
+typedef LEDController<LAMP_LED_CHANNELS> LampLEDController;
+
+#endif
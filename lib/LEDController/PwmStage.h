@@ -0,0 +1,109 @@
+#ifndef PWM_STAGE_H
+#define PWM_STAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <strings.h>
+
+// Platform-independent half of the LED output stage: timing validation,
+// duty scaling and per-channel phase placement. LEDController drives the
+// LEDC peripheral with these; tools/pwm_sim runs the same math natively.
+
+// Where each channel's pulse starts within the PWM period.
+enum class PwmPhaseMode : uint8_t {
+    ALIGNED,   // every pulse starts at 0: all current steps coincide
+    STAGGERED, // channel i starts at i/N of the period
+    PACKED,    // each pulse starts where the previous one ends
+};
+
+struct PwmTiming {
+    uint32_t frequency;
+    uint8_t resolution; // bits
+    PwmPhaseMode phase;
+};
+
+static constexpr uint32_t PWM_SOURCE_CLOCK_HZ = 80000000; // APB; PowerGovernor never lowers it
+static constexpr uint8_t PWM_MIN_RESOLUTION = 4;
+static constexpr uint8_t PWM_MAX_RESOLUTION = 14;       // LEDC limit on the ESP32-C3
+static constexpr uint32_t PWM_MAX_DIVIDER = 1023;       // integer part of the 10.8 timer divider
+static constexpr int PWM_LOGICAL_MAX = 2047;            // the 11-bit scale every caller uses
+
+inline bool pwmTimingValid(const PwmTiming &timing) {
+    if (timing.resolution < PWM_MIN_RESOLUTION || timing.resolution > PWM_MAX_RESOLUTION ||
+        timing.frequency == 0 || timing.phase > PwmPhaseMode::PACKED) {
+        return false;
+    }
+    const uint64_t counterHz = static_cast<uint64_t>(timing.frequency) << timing.resolution;
+    return counterHz <= PWM_SOURCE_CLOCK_HZ && PWM_SOURCE_CLOCK_HZ / counterHz <= PWM_MAX_DIVIDER;
+}
+
+// LEDC timer divider in 10.8 fixed point.
+inline uint32_t pwmDivider(const PwmTiming &timing) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(PWM_SOURCE_CLOCK_HZ) << 8) /
+                                 (static_cast<uint64_t>(timing.frequency) << timing.resolution));
+}
+
+inline uint32_t pwmPeriodTicks(uint8_t resolution) {
+    return 1u << resolution;
+}
+
+// Maps the logical 0-2047 scale onto the hardware counter, rounding to nearest.
+inline uint32_t pwmScaleDuty(int logical, uint8_t resolution) {
+    if (logical <= 0) {
+        return 0;
+    }
+    if (logical >= PWM_LOGICAL_MAX) {
+        return pwmPeriodTicks(resolution) - 1;
+    }
+    const uint32_t top = pwmPeriodTicks(resolution) - 1;
+    return (static_cast<uint32_t>(logical) * top + PWM_LOGICAL_MAX / 2) / PWM_LOGICAL_MAX;
+}
+
+// Fills hpoint[] (pulse start ticks) for n channels. LEDC keeps a pulse
+// high across the counter overflow when hpoint + duty passes the period, so
+// starts anywhere in the period are valid.
+inline void pwmPhasePoints(const uint32_t *duty, size_t n, uint8_t resolution, PwmPhaseMode phase,
+                           uint32_t *hpoint) {
+    const uint32_t period = pwmPeriodTicks(resolution);
+    uint32_t next = 0;
+    for (size_t i = 0; i < n; i++) {
+        switch (phase) {
+        case PwmPhaseMode::ALIGNED:
+            hpoint[i] = 0;
+            break;
+        case PwmPhaseMode::STAGGERED:
+            hpoint[i] = static_cast<uint32_t>(static_cast<uint64_t>(period) * i / n);
+            break;
+        case PwmPhaseMode::PACKED:
+            hpoint[i] = next;
+            next = (next + duty[i]) & (period - 1);
+            break;
+        }
+    }
+}
+
+inline const char *pwmPhaseName(PwmPhaseMode phase) {
+    switch (phase) {
+    case PwmPhaseMode::ALIGNED:
+        return "aligned";
+    case PwmPhaseMode::STAGGERED:
+        return "staggered";
+    case PwmPhaseMode::PACKED:
+        return "packed";
+    default:
+        return "unknown";
+    }
+}
+
+inline bool pwmParsePhase(const char *value, PwmPhaseMode &out) {
+    for (uint8_t i = 0; i <= static_cast<uint8_t>(PwmPhaseMode::PACKED); i++) {
+        const char *name = pwmPhaseName(static_cast<PwmPhaseMode>(i));
+        if (value && strcasecmp(value, name) == 0) {
+            out = static_cast<PwmPhaseMode>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
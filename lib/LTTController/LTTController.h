@@ -5,11 +5,11 @@
 
 class LTTController {
 private:
-    LEDController& ledController;
+    LampLEDController& ledController;
     void lttToRgb(int luminance, int temperature, int tintVal, int& r, int& g, int& b);
 
 public:
-    LTTController(LEDController& controller) : ledController(controller) {}
+    LTTController(LampLEDController& controller) : ledController(controller) {}
     void updateLTT(int luminance, int temperature, int tint);
 };
 
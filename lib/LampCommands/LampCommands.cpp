@@ -0,0 +1,198 @@
+#include "LampCommands.h"
+#include "Scenes.h"
+#include "Trace.h"
+
+#ifdef ARDUINO
+// Queued values are written by the async_tcp task and taken by the render loop.
+static portMUX_TYPE queueMux = portMUX_INITIALIZER_UNLOCKED;
+#define QUEUE_LOCK() portENTER_CRITICAL(&queueMux)
+#define QUEUE_UNLOCK() portEXIT_CRITICAL(&queueMux)
+#else
+#define QUEUE_LOCK()
+#define QUEUE_UNLOCK()
+#endif
+
+static uint32_t packColor(int r, int g, int b) {
+    return (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | static_cast<uint32_t>(b);
+}
+
+// Queued commands are traced under the queue lock, so an APPLY can never be
+// recorded between a value being queued and its own record.
+bool LampCommands::queueColor(int r, int g, int b) {
+    r = constrain(r, 0, 255);
+    g = constrain(g, 0, 255);
+    b = constrain(b, 0, 255);
+    QUEUE_LOCK();
+    traceEvent(TraceEvent::COMMAND, static_cast<uint8_t>(TraceCommand::RGB), 1, packColor(r, g, b));
+    const bool replaced = colorPending;
+    pendingColor[0] = r;
+    pendingColor[1] = g;
+    pendingColor[2] = b;
+    colorPending = true;
+    colorLast = true;
+    if (replaced) {
+        merged++;
+    }
+    QUEUE_UNLOCK();
+    return replaced;
+}
+
+bool LampCommands::queuePartyHz(float hz) {
+    hz = constrain(hz, 0.05f, 5.0f);
+    QUEUE_LOCK();
+    traceEvent(TraceEvent::COMMAND, static_cast<uint8_t>(TraceCommand::PARTY_HZ), 1,
+               static_cast<uint32_t>(hz * 1000.0f + 0.5f));
+    const bool replaced = hzPending;
+    pendingHz = hz;
+    hzPending = true;
+    colorLast = false;
+    if (replaced) {
+        merged++;
+    }
+    QUEUE_UNLOCK();
+    return replaced;
+}
+
+bool LampCommands::queueTiming(const PwmTiming &timing) {
+    if (!pwmTimingValid(timing)) {
+        return false;
+    }
+    QUEUE_LOCK();
+    pendingTiming = timing;
+    timingPending = true;
+    QUEUE_UNLOCK();
+    return true;
+}
+
+void LampCommands::applyQueued() {
+    QUEUE_LOCK();
+    const bool color = colorPending;
+    const bool hz = hzPending;
+    const int r = pendingColor[0], g = pendingColor[1], b = pendingColor[2];
+    const float partyHz = pendingHz;
+    const bool hzFirst = colorLast;
+    const bool retime = timingPending;
+    const PwmTiming timing = pendingTiming;
+    colorPending = false;
+    hzPending = false;
+    timingPending = false;
+    if (color || hz) {
+        traceEvent(TraceEvent::COMMAND, static_cast<uint8_t>(TraceCommand::APPLY));
+    }
+    QUEUE_UNLOCK();
+
+    if (retime) {
+        ledController.setTiming(timing);
+    }
+    // Both kinds switch modes, so replay them in the order they last arrived.
+    if (hz && hzFirst) {
+        applyPartyHz(partyHz);
+    }
+    if (color) {
+        applyColor(r, g, b);
+    }
+    if (hz && !hzFirst) {
+        applyPartyHz(partyHz);
+    }
+}
+
+void LampCommands::setColor(int r, int g, int b) {
+    applyQueued();
+    r = constrain(r, 0, 255);
+    g = constrain(g, 0, 255);
+    b = constrain(b, 0, 255);
+    traceEvent(TraceEvent::COMMAND, static_cast<uint8_t>(TraceCommand::RGB), 0, packColor(r, g, b));
+    applyColor(r, g, b);
+}
+
+void LampCommands::applyColor(int r, int g, int b) {
+    // Convert to 11-bit PWM range (0-2047)
+    int pwm_r = map(r, 0, 255, 0, 2047);
+    int pwm_g = map(g, 0, 255, 0, 2047);
+    int pwm_b = map(b, 0, 255, 0, 2047);
+
+    scheduler.cancelFade();
+    ledController.setPWMDirectly(pwm_r, pwm_g, pwm_b);
+
+    // Force remote mode so pots do not override
+    stateHandler.setMode(OperationMode::WIFI);
+}
+
+void LampCommands::setMode(OperationMode mode) {
+    applyQueued();
+    traceEvent(TraceEvent::COMMAND, static_cast<uint8_t>(TraceCommand::MODE), static_cast<uint16_t>(mode));
+    stateHandler.setMode(mode);
+    if (mode == OperationMode::OFF) {
+        ledController.setPWMDirectly(0, 0, 0);
+    }
+}
+
+bool LampCommands::applyScene(const char *name) {
+    const int index = findScene(name);
+    if (index < 0) {
+        return false;
+    }
+    applyQueued();
+    traceEvent(TraceEvent::COMMAND, static_cast<uint8_t>(TraceCommand::SCENE), static_cast<uint16_t>(index));
+    stateHandler.setMode(OperationMode::WIFI);
+    scheduler.cancelFade();
+    ledController.setPWMDirectly(SCENES[index].red, SCENES[index].green, SCENES[index].blue);
+    return true;
+}
+
+void LampCommands::setPartyHz(float hz) {
+    applyQueued();
+    hz = constrain(hz, 0.05f, 5.0f);
+    traceEvent(TraceEvent::COMMAND, static_cast<uint8_t>(TraceCommand::PARTY_HZ), 0,
+               static_cast<uint32_t>(hz * 1000.0f + 0.5f));
+    applyPartyHz(hz);
+}
+
+void LampCommands::applyPartyHz(float hz) {
+    stateHandler.setPartyHz(hz);
+    stateHandler.setMode(OperationMode::PARTY);
+}
+
+void LampCommands::setChannels(const int *values) {
+    applyQueued();
+    int clamped[LAMP_LED_CHANNELS];
+    for (size_t i = 0; i < LAMP_LED_CHANNELS; i++) {
+        clamped[i] = constrain(values[i], 0, 2047);
+    }
+    traceEvent(TraceEvent::COMMAND, static_cast<uint8_t>(TraceCommand::FRAME), static_cast<uint16_t>(clamped[0]),
+               (static_cast<uint32_t>(clamped[1]) << 16) | static_cast<uint32_t>(clamped[2]));
+
+    scheduler.cancelFade();
+    ledController.setChannels(clamped);
+    stateHandler.setMode(OperationMode::WIFI);
+}
+
+void LampCommands::unlock() {
+    applyQueued();
+    traceEvent(TraceEvent::COMMAND, static_cast<uint8_t>(TraceCommand::UNLOCK));
+    ledController.unlock();
+    ledController.checkAndUpdatePowerLimit();
+}
+
+void LampCommands::resetToSafeMode() {
+    applyQueued();
+    traceEvent(TraceEvent::COMMAND, static_cast<uint8_t>(TraceCommand::RESET));
+    ledController.resetToSafeMode();
+    ledController.checkAndUpdatePowerLimit();
+}
+
+void LampCommands::getColor8(int &r, int &g, int &b) const {
+    ledController.getRequestedValues(r, g, b);
+    r = (r * 255 + 1023) / 2047;
+    g = (g * 255 + 1023) / 2047;
+    b = (b * 255 + 1023) / 2047;
+}
+
+void LampCommands::getTargetColor8(int &r, int &g, int &b) const {
+    if (!scheduler.fadeTarget(r, g, b)) {
+        ledController.getRequestedValues(r, g, b);
+    }
+    r = (r * 255 + 1023) / 2047;
+    g = (g * 255 + 1023) / 2047;
+    b = (b * 255 + 1023) / 2047;
+}
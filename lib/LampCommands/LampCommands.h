@@ -0,0 +1,73 @@
+#ifndef LAMP_COMMANDS_H
+#define LAMP_COMMANDS_H
+
+#include <Arduino.h>
+#include "LEDController.h"
+#include "State.h"
+#include "Scheduler.h"
+
+// The lamp's control surface, shared by every transport (HTTP, MQTT, ...) so
+// a command means the same thing and is traced the same way wherever it
+// arrives from.
+class LampCommands {
+private:
+    LampLEDController &ledController;
+    StateHandler &stateHandler;
+    Scheduler &scheduler;
+
+    bool colorPending = false;
+    int pendingColor[3] = {0, 0, 0};
+    bool hzPending = false;
+    float pendingHz = 0.0f;
+    bool colorLast = false;
+    bool timingPending = false;
+    PwmTiming pendingTiming = {};
+    uint32_t merged = 0;
+
+    // The queued paths, traced when the command arrived.
+    void applyColor(int r, int g, int b);
+    void applyPartyHz(float hz);
+
+public:
+    LampCommands(LampLEDController &led, StateHandler &state, Scheduler &sched)
+        : ledController(led), stateHandler(state), scheduler(sched) {}
+
+    // 0-255 per channel; switches to remote mode.
+    void setColor(int r, int g, int b);
+    // Latest-wins variants for streams of updates (color wheel drags, rate
+    // sliders): a value still waiting for applyQueued() is replaced, not
+    // queued behind. Return true when they merged with a pending value.
+    // Traced on arrival; applyQueued() traces APPLY when the survivors land.
+    bool queueColor(int r, int g, int b);
+    bool queuePartyHz(float hz);
+    // PWM timing is reprogrammed on the loop task so it cannot race the
+    // render loop's duty writes. Returns false, queueing nothing, when the
+    // combination is out of LEDC range.
+    bool queueTiming(const PwmTiming &timing);
+    // Applies whatever is pending; called every render tick and before any
+    // immediate command so commands keep their arrival order.
+    void applyQueued();
+    uint32_t mergedCount() const { return merged; }
+    void setMode(OperationMode mode);
+    // Returns false for unknown scenes.
+    bool applyScene(const char *name);
+    // Clamps to 0.05-5 Hz and switches to party mode.
+    void setPartyHz(float hz);
+    // Raw logical channel values (0-2047, channel-map order), for streaming
+    // hosts; switches to remote mode like setColor().
+    void setChannels(const int *values);
+    void unlock();
+    void resetToSafeMode();
+
+    // Requested color scaled back to 0-255, for state publishers.
+    void getColor8(int &r, int &g, int &b) const;
+    // Same scale, but where a running fade is heading rather than its
+    // current step, so the value holds still for the whole fade.
+    void getTargetColor8(int &r, int &g, int &b) const;
+
+    OperationMode getMode() const { return stateHandler.getCurrentMode(); }
+    float getPartyHz() const { return stateHandler.getPartyHz(); }
+    bool isUnlocked() const { return ledController.isUnlocked(); }
+};
+
+#endif
@@ -0,0 +1,255 @@
+#include "MqttBridge.h"
+#include <WiFi.h>
+#include "FormParser.h"
+#include "Scenes.h"
+#include "DebugLog.h"
+#include "PowerGovernor.h"
+
+void MqttBridge::begin() {
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    snprintf(deviceId, sizeof(deviceId), "cs_%02x%02x%02x", mac[3], mac[4], mac[5]);
+    snprintf(base, sizeof(base), "colorshadow/%s", deviceId);
+    snprintf(availabilityTopic, sizeof(availabilityTopic), "%s/availability", base);
+    snprintf(stateTopic, sizeof(stateTopic), "%s/state", base);
+
+    preferences.begin("mqtt", true);
+    preferences.getString("host", host, sizeof(host));
+    port = preferences.getUShort("port", 1883);
+    preferences.getString("user", user, sizeof(user));
+    preferences.getString("pass", password, sizeof(password));
+    preferences.end();
+
+    client.setClientId(deviceId);
+    client.setKeepAlive(30);
+    client.setWill(availabilityTopic, 0, true, "offline");
+
+    client.onConnect([this](bool sessionPresent)
+                     {
+        (void)sessionPresent;
+        connected = true;
+        announcePending = true;
+        backoffMs = 1000;
+        logStatus("MQTT", "Connected to %s:%u as %s", host, port, deviceId); });
+
+    client.onDisconnect([this](AsyncMqttClientDisconnectReason reason)
+                        {
+        if (connected) {
+            logStatus("MQTT", "Disconnected, reason=%d", static_cast<int>(reason));
+        }
+        connected = false; });
+
+    client.onMessage([this](char *topic, char *payload, AsyncMqttClientMessageProperties properties,
+                            size_t len, size_t index, size_t total)
+                     {
+        (void)properties;
+        if (index != 0 || len != total) {
+            return; // commands are tiny; ignore anything fragmented
+        }
+        char text[48];
+        if (len >= sizeof(text)) {
+            return;
+        }
+        memcpy(text, payload, len);
+        text[len] = '\0';
+        handleMessage(topic, text); });
+
+    applyConfig();
+    initialized = true;
+}
+
+void MqttBridge::applyConfig() {
+    client.setServer(host, port);
+    client.setCredentials(user[0] ? user : nullptr, password[0] ? password : nullptr);
+    nextAttemptMs = 0;
+    backoffMs = 1000;
+}
+
+void MqttBridge::configure(const char *newHost, uint16_t newPort, const char *newUser, const char *newPassword) {
+    strncpy(host, newHost ? newHost : "", sizeof(host) - 1);
+    port = newPort ? newPort : 1883;
+    strncpy(user, newUser ? newUser : "", sizeof(user) - 1);
+    strncpy(password, newPassword ? newPassword : "", sizeof(password) - 1);
+
+    preferences.begin("mqtt", false);
+    preferences.putString("host", host);
+    preferences.putUShort("port", port);
+    preferences.putString("user", user);
+    preferences.putString("pass", password);
+    preferences.end();
+
+    reconfigurePending = true; // applied from update(), not the caller's task
+    logStatus("MQTT", "Broker set to %s:%u", host[0] ? host : "(disabled)", port);
+}
+
+void MqttBridge::update(unsigned long nowMs) {
+    if (!initialized) {
+        return;
+    }
+    if (reconfigurePending) {
+        reconfigurePending = false;
+        if (client.connected()) {
+            client.disconnect();
+        }
+        applyConfig();
+    }
+    if (host[0] == '\0') {
+        return;
+    }
+
+    if (!connected) {
+        // connect() only starts the TCP handshake; the result arrives on the
+        // async_tcp task, so this never stalls the caller.
+        if (WiFi.isConnected() && static_cast<long>(nowMs - nextAttemptMs) >= 0 && !client.connected()) {
+            client.connect();
+            reconnects++;
+            nextAttemptMs = nowMs + backoffMs;
+            backoffMs = backoffMs * 2 > MAX_BACKOFF_MS ? MAX_BACKOFF_MS : backoffMs * 2;
+        }
+        return;
+    }
+
+    if (announcePending) {
+        announcePending = false;
+        announce();
+        havePublished = false; // the broker may have lost retained state
+    }
+
+    if (nowMs - lastPublishMs < MIN_PUBLISH_INTERVAL_MS) {
+        return;
+    }
+    const PublishedState state = captureState();
+    if (!havePublished || !(state == lastPublished)) {
+        publishState(state);
+        lastPublished = state;
+        lastPublishMs = nowMs;
+        havePublished = true;
+    }
+}
+
+MqttBridge::PublishedState MqttBridge::captureState() const {
+    PublishedState state;
+    state.mode = commands.getMode();
+    if (state.mode == OperationMode::PARTY) {
+        // The party output changes every frame; report the last steady color
+        // instead, so the retained state only changes on commands.
+        state.r = lastOnColor[0];
+        state.g = lastOnColor[1];
+        state.b = lastOnColor[2];
+    } else {
+        commands.getTargetColor8(state.r, state.g, state.b);
+    }
+    state.partyCentiHz = static_cast<int>(commands.getPartyHz() * 100.0f + 0.5f);
+    state.unlocked = commands.isUnlocked();
+    return state;
+}
+
+void MqttBridge::publishState(const PublishedState &state) {
+    if (state.r || state.g || state.b) {
+        lastOnColor[0] = state.r;
+        lastOnColor[1] = state.g;
+        lastOnColor[2] = state.b;
+    }
+    const bool on = state.mode == OperationMode::PARTY || (state.mode == OperationMode::WIFI && (state.r || state.g || state.b));
+
+    char payload[160];
+    int len = snprintf(payload, sizeof(payload),
+                       "{\"state\":\"%s\",\"mode\":\"%s\",\"effect\":\"%s\",\"r\":%d,\"g\":%d,\"b\":%d,"
+                       "\"partyHz\":%d.%02d,\"unlocked\":%s}",
+                       on ? "ON" : "OFF", operationModeName(state.mode),
+                       state.mode == OperationMode::PARTY ? "party" : "none", state.r, state.g, state.b,
+                       state.partyCentiHz / 100, state.partyCentiHz % 100, state.unlocked ? "true" : "false");
+    if (client.publish(stateTopic, 0, true, payload, len)) {
+        published++;
+    }
+}
+
+// Availability, command subscriptions and Home Assistant discovery.
+void MqttBridge::announce() {
+    char topic[72];
+    client.publish(availabilityTopic, 0, true, "online");
+    snprintf(topic, sizeof(topic), "%s/set/#", base);
+    client.subscribe(topic, 0);
+
+    char effects[128];
+    size_t used = snprintf(effects, sizeof(effects), "\"none\",\"party\"");
+    for (size_t i = 0; i < SCENE_COUNT && used < sizeof(effects); i++) {
+        if (strcmp(SCENES[i].name, "off") != 0) {
+            used += snprintf(effects + used, sizeof(effects) - used, ",\"%s\"", SCENES[i].name);
+        }
+    }
+
+    static char payload[900]; // only touched from loop()
+    snprintf(topic, sizeof(topic), "homeassistant/light/%s/config", deviceId);
+    snprintf(payload, sizeof(payload),
+             "{\"name\":\"Color Shadow\",\"uniq_id\":\"%s_light\",\"avty_t\":\"%s\","
+             "\"cmd_t\":\"%s/set/power\",\"stat_t\":\"%s\",\"stat_val_tpl\":\"{{ value_json.state }}\","
+             "\"rgb_cmd_t\":\"%s/set/color\",\"rgb_stat_t\":\"%s\","
+             "\"rgb_val_tpl\":\"{{ value_json.r }},{{ value_json.g }},{{ value_json.b }}\","
+             "\"fx_cmd_t\":\"%s/set/effect\",\"fx_stat_t\":\"%s\",\"fx_val_tpl\":\"{{ value_json.effect }}\","
+             "\"fx_list\":[%s],"
+             "\"dev\":{\"ids\":[\"%s\"],\"name\":\"Color Shadow Lamp\",\"mdl\":\"ESP32-C3\"}}",
+             deviceId, availabilityTopic, base, stateTopic, base, stateTopic, base, stateTopic, effects, deviceId);
+    client.publish(topic, 0, true, payload);
+
+    snprintf(topic, sizeof(topic), "homeassistant/number/%s_party_hz/config", deviceId);
+    snprintf(payload, sizeof(payload),
+             "{\"name\":\"Color Shadow party speed\",\"uniq_id\":\"%s_party_hz\",\"avty_t\":\"%s\","
+             "\"cmd_t\":\"%s/set/party_hz\",\"stat_t\":\"%s\",\"val_tpl\":\"{{ value_json.partyHz }}\","
+             "\"min\":0.05,\"max\":5,\"step\":0.05,\"unit_of_meas\":\"Hz\",\"dev\":{\"ids\":[\"%s\"]}}",
+             deviceId, availabilityTopic, base, stateTopic, deviceId);
+    client.publish(topic, 0, true, payload);
+}
+
+void MqttBridge::handleMessage(const char *topic, const char *payload) {
+    const size_t baseLen = strlen(base);
+    if (strncmp(topic, base, baseLen) != 0 || strncmp(topic + baseLen, "/set/", 5) != 0) {
+        return;
+    }
+    const char *command = topic + baseLen + 5;
+    received++;
+    powerGovernor.wake();
+
+    if (strcmp(command, "color") == 0) {
+        int r, g, b;
+        if (sscanf(payload, "%d,%d,%d", &r, &g, &b) == 3) {
+            commands.queueColor(r, g, b); // slider bursts collapse to the latest value
+        }
+    } else if (strcmp(command, "mode") == 0) {
+        OperationMode mode;
+        if (parseOperationMode(payload, mode)) {
+            commands.setMode(mode);
+        }
+    } else if (strcmp(command, "scene") == 0) {
+        commands.applyScene(payload);
+    } else if (strcmp(command, "party_hz") == 0) {
+        float hz;
+        if (formParseFloat(payload, hz)) {
+            commands.queuePartyHz(hz);
+        }
+    } else if (strcmp(command, "power") == 0) {
+        if (strcasecmp(payload, "OFF") == 0) {
+            commands.setMode(OperationMode::OFF);
+        } else if (strcasecmp(payload, "ON") == 0 && commands.getMode() == OperationMode::OFF) {
+            commands.setColor(lastOnColor[0], lastOnColor[1], lastOnColor[2]);
+        }
+    } else if (strcmp(command, "effect") == 0) {
+        if (strcasecmp(payload, "party") == 0) {
+            commands.setPartyHz(commands.getPartyHz());
+        } else if (strcasecmp(payload, "none") == 0) {
+            commands.setMode(OperationMode::WIFI);
+        } else {
+            commands.applyScene(payload);
+        }
+    }
+}
+
+size_t MqttBridge::writeStatusJson(char *out, size_t maxLen) const {
+    int len = snprintf(out, maxLen,
+                       "{\"enabled\":%s,\"connected\":%s,\"host\":\"%s\",\"port\":%u,\"base\":\"%s\","
+                       "\"published\":%lu,\"received\":%lu,\"connectAttempts\":%lu}",
+                       host[0] ? "true" : "false", connected ? "true" : "false", host, port, base,
+                       static_cast<unsigned long>(published), static_cast<unsigned long>(received),
+                       static_cast<unsigned long>(reconnects));
+    return len < 0 ? 0 : static_cast<size_t>(len);
+}
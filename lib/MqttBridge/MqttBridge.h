@@ -0,0 +1,85 @@
+#ifndef MQTT_BRIDGE_H
+#define MQTT_BRIDGE_H
+
+#include <Arduino.h>
+#include <AsyncMqttClient.h>
+#include <Preferences.h>
+#include "LampCommands.h"
+
+// Home-automation bridge over MQTT. Runs on AsyncTCP like the web server, so
+// connecting and receiving never block the render loop; loop() only calls
+// update() to schedule reconnects and publish state when it changes.
+//
+// Topics, with <base> = colorshadow/<device id>:
+//   <base>/availability   online/offline (retained, offline is the LWT)
+//   <base>/state          JSON state (retained, published on change only)
+//   <base>/set/color      "r,g,b" 0-255
+//   <base>/set/mode       party | wifi | off
+//   <base>/set/scene      scene name
+//   <base>/set/party_hz   0.05-5
+//   <base>/set/power      ON | OFF            (Home Assistant light)
+//   <base>/set/effect     none | party | scene (Home Assistant light)
+class MqttBridge {
+public:
+    static constexpr unsigned long MIN_PUBLISH_INTERVAL_MS = 100; // coalesces drags
+    static constexpr unsigned long MAX_BACKOFF_MS = 60000;
+
+    explicit MqttBridge(LampCommands &lampCommands) : commands(lampCommands) {}
+
+    // Loads the broker config; call once the network is up.
+    void begin();
+    void update(unsigned long nowMs);
+
+    // Persists a new broker (empty host disables the bridge) and reconnects.
+    void configure(const char *host, uint16_t port, const char *user, const char *password);
+    size_t writeStatusJson(char *out, size_t maxLen) const;
+
+private:
+    struct PublishedState {
+        OperationMode mode;
+        int r, g, b;
+        int partyCentiHz;
+        bool unlocked;
+
+        bool operator==(const PublishedState &other) const {
+            return mode == other.mode && r == other.r && g == other.g && b == other.b &&
+                   partyCentiHz == other.partyCentiHz && unlocked == other.unlocked;
+        }
+    };
+
+    AsyncMqttClient client;
+    LampCommands &commands;
+    Preferences preferences;
+
+    char host[64] = "";
+    uint16_t port = 1883;
+    char user[32] = "";
+    char password[64] = "";
+    char deviceId[16] = "";
+    char base[40] = "";
+    char availabilityTopic[56] = "";
+    char stateTopic[48] = "";
+
+    bool initialized = false;
+    volatile bool reconfigurePending = false;
+    volatile bool connected = false;
+    volatile bool announcePending = false;
+    unsigned long nextAttemptMs = 0;
+    unsigned long backoffMs = 1000;
+    unsigned long lastPublishMs = 0;
+    bool havePublished = false;
+    PublishedState lastPublished = {};
+    int lastOnColor[3] = {255, 255, 255};
+
+    uint32_t published = 0;
+    uint32_t received = 0;
+    uint32_t reconnects = 0;
+
+    PublishedState captureState() const;
+    void publishState(const PublishedState &state);
+    void announce();
+    void handleMessage(const char *topic, const char *payload);
+    void applyConfig();
+};
+
+#endif
@@ -0,0 +1,177 @@
+#ifndef OTA_STREAM_H
+#define OTA_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Platform-independent half of the OTA path: a streaming heatshrink decoder
+// and a fixed-size chunk writer. Neither touches Arduino APIs, so both can be
+// driven on the host against a fake FlashSink.
+
+// Destination for whole chunks of decompressed image. The device backend
+// wraps the Update library; a host fake can simply record the bytes.
+class FlashSink {
+public:
+    virtual ~FlashSink() {}
+    virtual bool write(const uint8_t *data, size_t len) = 0;
+};
+
+// Collects output into CHUNK_SIZE blocks (one flash sector) so the sink sees
+// sector-aligned writes regardless of how the network fragments the body.
+class ChunkWriter {
+public:
+    static constexpr size_t CHUNK_SIZE = 4096;
+
+    explicit ChunkWriter(FlashSink &sink) : sink(sink) {}
+
+    void reset() {
+        fill = 0;
+        written = 0;
+        failed = false;
+    }
+
+    bool push(uint8_t byte) {
+        if (failed) {
+            return false;
+        }
+        chunk[fill++] = byte;
+        if (fill == CHUNK_SIZE) {
+            return flush();
+        }
+        return true;
+    }
+
+    bool flush() {
+        if (failed) {
+            return false;
+        }
+        if (fill > 0) {
+            if (!sink.write(chunk, fill)) {
+                failed = true;
+                return false;
+            }
+            written += fill;
+            fill = 0;
+        }
+        return true;
+    }
+
+    size_t bytesWritten() const {
+        return written;
+    }
+
+    bool hasFailed() const {
+        return failed;
+    }
+
+private:
+    FlashSink &sink;
+    uint8_t chunk[CHUNK_SIZE];
+    size_t fill = 0;
+    size_t written = 0;
+    bool failed = false;
+};
+
+// Streaming decoder for the heatshrink LZSS bitstream. Images must be
+// compressed with matching parameters: `heatshrink -e -w 10 -l 5`.
+// Input may arrive in arbitrarily sized pieces; partial bit state is kept
+// between calls. Memory use is the 1 KB window plus a few counters.
+class HeatshrinkDecoder {
+public:
+    static constexpr uint8_t WINDOW_BITS = 10;
+    static constexpr uint8_t LOOKAHEAD_BITS = 5;
+    static constexpr size_t WINDOW_SIZE = 1u << WINDOW_BITS;
+
+    explicit HeatshrinkDecoder(ChunkWriter &out) : out(out) {}
+
+    void reset() {
+        memset(window, 0, sizeof(window));
+        head = 0;
+        beginField(State::TAG, 1);
+        backrefIndex = 0;
+    }
+
+    // Feeds compressed bytes; returns false once the output sink fails.
+    bool feed(const uint8_t *data, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            uint8_t byte = data[i];
+            for (int bit = 7; bit >= 0; bit--) {
+                if (!pushBit((byte >> bit) & 1)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    enum class State : uint8_t {
+        TAG,
+        LITERAL,
+        BACKREF_INDEX,
+        BACKREF_COUNT,
+    };
+
+    ChunkWriter &out;
+    uint8_t window[WINDOW_SIZE];
+    uint16_t head = 0;
+    State state = State::TAG;
+    uint8_t bitsNeeded = 1;
+    uint8_t bitsHave = 0;
+    uint16_t accum = 0;
+    uint16_t backrefIndex = 0;
+
+    void beginField(State next, uint8_t bits) {
+        state = next;
+        bitsNeeded = bits;
+        bitsHave = 0;
+        accum = 0;
+    }
+
+    bool emit(uint8_t byte) {
+        window[head & (WINDOW_SIZE - 1)] = byte;
+        head++;
+        return out.push(byte);
+    }
+
+    bool pushBit(uint8_t bit) {
+        accum = static_cast<uint16_t>((accum << 1) | bit);
+        if (++bitsHave < bitsNeeded) {
+            return true;
+        }
+
+        switch (state) {
+        case State::TAG:
+            if (accum) {
+                beginField(State::LITERAL, 8);
+            } else {
+                beginField(State::BACKREF_INDEX, WINDOW_BITS);
+            }
+            return true;
+        case State::LITERAL: {
+            uint8_t literal = static_cast<uint8_t>(accum);
+            beginField(State::TAG, 1);
+            return emit(literal);
+        }
+        case State::BACKREF_INDEX:
+            backrefIndex = static_cast<uint16_t>(accum + 1);
+            beginField(State::BACKREF_COUNT, LOOKAHEAD_BITS);
+            return true;
+        case State::BACKREF_COUNT: {
+            uint16_t count = static_cast<uint16_t>(accum + 1);
+            beginField(State::TAG, 1);
+            for (uint16_t i = 0; i < count; i++) {
+                uint8_t byte = window[(head - backrefIndex) & (WINDOW_SIZE - 1)];
+                if (!emit(byte)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        }
+        return true;
+    }
+};
+
+#endif
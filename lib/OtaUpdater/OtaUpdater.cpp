@@ -0,0 +1,209 @@
+#include "OtaUpdater.h"
+#include <Update.h>
+#include <esp_ota_ops.h>
+#include <mbedtls/md.h>
+#include "DebugLog.h"
+
+static int hexNibble(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool parseHex(const char *hex, uint8_t *out, size_t len) {
+    if (hex == nullptr || strlen(hex) != len * 2) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        int hi = hexNibble(hex[i * 2]);
+        int lo = hexNibble(hex[i * 2 + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out[i] = static_cast<uint8_t>((hi << 4) | lo);
+    }
+    return true;
+}
+
+// Compares every byte so the time taken does not reveal the first mismatch.
+static bool sameBytes(const uint8_t *a, const uint8_t *b, size_t len) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < len; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+bool UpdateFlashSink::write(const uint8_t *data, size_t len) {
+    mbedtls_sha256_update(&hash, data, len);
+    return Update.write(const_cast<uint8_t *>(data), len) == len;
+}
+
+bool OtaUpdater::begin(const char *sha256Hex, const char *signatureHex, const char *encoding) {
+    if (active) {
+        error = "update already in progress";
+        return false;
+    }
+    denied = false;
+    malformed = true; // until the parameters check out
+    bool useCompression;
+    if (encoding != nullptr && strcmp(encoding, "heatshrink") == 0) {
+        useCompression = true;
+    } else if (encoding != nullptr && strcmp(encoding, "raw") == 0) {
+        useCompression = false;
+    } else {
+        error = "encoding must be raw or heatshrink";
+        return false;
+    }
+    if (sha256Hex == nullptr || strlen(sha256Hex) != 64) {
+        error = "sha256 missing";
+        return false;
+    }
+    if (!parseHex(sha256Hex, expectedHash, sizeof(expectedHash))) {
+        error = "sha256 malformed";
+        return false;
+    }
+    malformed = false;
+
+    static const char KEY[] = OTA_HMAC_KEY;
+    uint8_t signature[32];
+    uint8_t expectedSignature[32];
+    if (sizeof(KEY) <= 1) {
+        error = "ota key not set";
+        denied = true;
+        return false;
+    }
+    if (!parseHex(signatureHex, signature, sizeof(signature))) {
+        error = "signature missing";
+        denied = true;
+        return false;
+    }
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), reinterpret_cast<const uint8_t *>(KEY),
+                    sizeof(KEY) - 1, expectedHash, sizeof(expectedHash), expectedSignature);
+    if (!sameBytes(signature, expectedSignature, sizeof(signature))) {
+        error = "signature invalid";
+        denied = true;
+        logStatus("OTA", "Rejected upload with a bad signature");
+        return false;
+    }
+
+    // UPDATE_SIZE_UNKNOWN lets the Update library erase sector by sector as
+    // chunks arrive instead of wiping the whole slot up front.
+    if (!Update.begin(UPDATE_SIZE_UNKNOWN, U_FLASH)) {
+        error = "no OTA partition";
+        return false;
+    }
+
+    mbedtls_sha256_init(&sink.hash);
+    mbedtls_sha256_starts_ret(&sink.hash, 0);
+    writer.reset();
+    decoder.reset();
+    compressed = useCompression;
+    active = true;
+    error = "";
+    logStatus("OTA", "Update started (%s)", compressed ? "heatshrink" : "raw");
+    return true;
+}
+
+bool OtaUpdater::write(const uint8_t *data, size_t len) {
+    if (!active) {
+        return false;
+    }
+
+    bool ok = true;
+    if (compressed) {
+        ok = decoder.feed(data, len);
+    } else {
+        for (size_t i = 0; i < len && ok; i++) {
+            ok = writer.push(data[i]);
+        }
+    }
+
+    if (!ok) {
+        abort("flash write failed");
+    }
+    return ok;
+}
+
+bool OtaUpdater::finish() {
+    if (!active) {
+        return false;
+    }
+    if (!writer.flush()) {
+        abort("flash write failed");
+        return false;
+    }
+
+    uint8_t actual[32];
+    mbedtls_sha256_finish_ret(&sink.hash, actual);
+    mbedtls_sha256_free(&sink.hash);
+    if (memcmp(actual, expectedHash, sizeof(actual)) != 0) {
+        abort("sha256 mismatch");
+        return false;
+    }
+
+    if (!Update.end(true)) {
+        abort("image rejected");
+        return false;
+    }
+    active = false;
+
+    Preferences prefs;
+    prefs.begin("ota", false);
+    prefs.putBool("pending", true);
+    prefs.putUChar("attempts", 0);
+    prefs.end();
+
+    logStatus("OTA", "Update verified, %u bytes written", static_cast<unsigned>(writer.bytesWritten()));
+    return true;
+}
+
+void OtaUpdater::abort(const char *reason) {
+    if (active) {
+        Update.abort();
+        mbedtls_sha256_free(&sink.hash);
+    }
+    active = false;
+    error = reason;
+    logStatus("OTA", "Update aborted: %s", reason);
+}
+
+void OtaUpdater::checkBootHealth() {
+    Preferences prefs;
+    prefs.begin("ota", false);
+    if (!prefs.getBool("pending", false)) {
+        prefs.end();
+        return;
+    }
+
+    uint8_t attempts = prefs.getUChar("attempts", 0) + 1;
+    prefs.putUChar("attempts", attempts);
+    logStatus("OTA", "New image boot attempt %u/%u", attempts, MAX_BOOT_ATTEMPTS);
+
+    if (attempts >= MAX_BOOT_ATTEMPTS) {
+        // With two OTA slots the "next" partition is the one we came from.
+        const esp_partition_t *previous = esp_ota_get_next_update_partition(nullptr);
+        prefs.putBool("pending", false);
+        prefs.end();
+        if (previous && esp_ota_set_boot_partition(previous) == ESP_OK) {
+            logStatus("OTA", "Rolling back to %s", previous->label);
+            delay(100);
+            ESP.restart();
+        }
+        return;
+    }
+    prefs.end();
+}
+
+void OtaUpdater::confirmBoot() {
+    Preferences prefs;
+    prefs.begin("ota", false);
+    if (prefs.getBool("pending", false)) {
+        prefs.putBool("pending", false);
+        logStatus("OTA", "New image confirmed");
+    }
+    prefs.end();
+    // Also settles the bootloader's own rollback state when it is enabled.
+    esp_ota_mark_app_valid_cancel_rollback();
+}
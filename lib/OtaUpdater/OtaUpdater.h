@@ -0,0 +1,70 @@
+#ifndef OTA_UPDATER_H
+#define OTA_UPDATER_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <mbedtls/sha256.h>
+#include "OtaStream.h"
+
+// Shared secret for signed uploads, baked in at build time from the
+// LAMP_OTA_KEY environment variable (see platformio.ini). Without one the
+// lamp refuses every upload.
+#ifndef OTA_HMAC_KEY
+#define OTA_HMAC_KEY ""
+#endif
+
+// Writes into the inactive app partition through the Update library and
+// hashes exactly the bytes that reach flash.
+class UpdateFlashSink : public FlashSink {
+public:
+    mbedtls_sha256_context hash;
+
+    bool write(const uint8_t *data, size_t len) override;
+};
+
+// Streams a (optionally heatshrink-compressed) firmware image into the
+// inactive OTA slot, verifies its SHA-256 and switches the boot partition.
+// The upload must carry HMAC-SHA256(OTA_HMAC_KEY, sha256) as its signature;
+// it is checked before anything is erased, and the digest check at the end
+// then ties the signature to the bytes actually written.
+// Boot health is tracked in NVS so an image that never confirms itself is
+// rolled back after MAX_BOOT_ATTEMPTS resets.
+class OtaUpdater {
+public:
+    static constexpr uint8_t MAX_BOOT_ATTEMPTS = 3;
+
+    OtaUpdater() : writer(sink), decoder(writer) {}
+
+    // encoding is "heatshrink" or "raw"; anything else is refused as malformed.
+    bool begin(const char *sha256Hex, const char *signatureHex, const char *encoding);
+    bool write(const uint8_t *data, size_t len);
+    bool finish();
+    void abort(const char *reason);
+
+    bool isActive() const { return active; }
+    const char *lastError() const { return error; }
+    // The last begin() failed on the signature rather than on the request.
+    bool wasDenied() const { return denied; }
+    // The last begin() failed on a missing or malformed parameter.
+    bool wasMalformed() const { return malformed; }
+    size_t imageBytes() const { return writer.bytesWritten(); }
+
+    // Call first thing in setup(): counts boot attempts of a freshly
+    // installed image and reverts to the previous slot if it keeps failing.
+    static void checkBootHealth();
+    // Call once the firmware is known good (network and server up).
+    static void confirmBoot();
+
+private:
+    UpdateFlashSink sink;
+    ChunkWriter writer;
+    HeatshrinkDecoder decoder;
+    uint8_t expectedHash[32];
+    bool compressed = false;
+    bool active = false;
+    bool denied = false;
+    bool malformed = false;
+    const char *error = "";
+};
+
+#endif
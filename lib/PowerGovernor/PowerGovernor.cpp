@@ -0,0 +1,209 @@
+#include "PowerGovernor.h"
+#include <WiFi.h>
+#include "StallMonitor.h"
+#include "DebugLog.h"
+
+PowerGovernor powerGovernor;
+
+static const char *const LEVEL_NAMES[3] = {"active", "idle", "dark"};
+
+const char *powerPolicyName(PowerPolicy policy) {
+    switch (policy) {
+    case PowerPolicy::PERFORMANCE:
+        return "performance";
+    case PowerPolicy::BALANCED:
+        return "balanced";
+    case PowerPolicy::SAVER:
+        return "saver";
+    default:
+        return "unknown";
+    }
+}
+
+bool parsePowerPolicy(const char *value, PowerPolicy &out) {
+    if (value == nullptr) {
+        return false;
+    }
+    for (uint8_t i = 0; i <= static_cast<uint8_t>(PowerPolicy::SAVER); i++) {
+        if (strcasecmp(value, powerPolicyName(static_cast<PowerPolicy>(i))) == 0) {
+            out = static_cast<PowerPolicy>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void PowerGovernor::begin() {
+    loopTask = xTaskGetCurrentTaskHandle();
+
+    preferences.begin("power", true);
+    uint8_t stored = preferences.getUChar("policy", static_cast<uint8_t>(PowerPolicy::BALANCED));
+    preferences.end();
+    policy = stored <= static_cast<uint8_t>(PowerPolicy::SAVER) ? static_cast<PowerPolicy>(stored)
+                                                                 : PowerPolicy::BALANCED;
+
+    // Probe what the SDK supports once; the lock is held whenever we are ACTIVE.
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "render", &cpuLock) == ESP_OK) {
+        esp_pm_lock_acquire(cpuLock);
+        configurePm(true);
+        lightSleepAvailable = lightSleepOn;
+        configurePm(false);
+        pmAvailable = true;
+        if (lightSleepAvailable && esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "usb", &usbLock) != ESP_OK) {
+            usbLock = nullptr;
+        }
+    }
+
+    lastActivityMs = millis();
+    levelSinceMs = lastActivityMs;
+    level = PowerLevel::ACTIVE;
+    logStatus("POWER", "policy=%s pm=%s lightSleep=%s", powerPolicyName(policy), pmAvailable ? "dfs" : "manual",
+              lightSleepAvailable ? "yes" : "unsupported");
+}
+
+void PowerGovernor::configurePm(bool lightSleep) {
+#if CONFIG_IDF_TARGET_ESP32C3
+    esp_pm_config_esp32c3_t config;
+#else
+    esp_pm_config_esp32_t config;
+#endif
+    config.max_freq_mhz = MAX_CPU_MHZ;
+    config.min_freq_mhz = IDLE_CPU_MHZ;
+    config.light_sleep_enable = lightSleep;
+    // Light sleep needs CONFIG_FREERTOS_USE_TICKLESS_IDLE; without it the call fails.
+    lightSleepOn = esp_pm_configure(&config) == ESP_OK && lightSleep;
+}
+
+void PowerGovernor::wake() {
+    lastActivityMs = millis();
+    if (!wakePending) {
+        wakeRequestedUs = micros();
+        wakePending = true;
+        // Timed up to the first PWM write, whether the handler makes it or
+        // the next render tick applies a queued command. A later command
+        // restarts the clock, as the earlier one changed no output.
+        if (level != PowerLevel::ACTIVE || measuring) {
+            measuringFromUs = wakeRequestedUs;
+            measuring = true;
+        }
+    }
+    if (loopTask) {
+        xTaskNotifyGive(loopTask);
+    }
+}
+
+void PowerGovernor::setUsbHost(bool present) {
+    if (present == usbHost) {
+        return;
+    }
+    usbHost = present;
+    if (usbLock) {
+        if (present) {
+            esp_pm_lock_acquire(usbLock);
+        } else {
+            esp_pm_lock_release(usbLock);
+        }
+    }
+    logStatus("POWER", "USB host %s", present ? "attached, light sleep held off" : "detached");
+}
+
+void PowerGovernor::setPolicy(PowerPolicy next) {
+    preferences.begin("power", false);
+    preferences.putUChar("policy", static_cast<uint8_t>(next));
+    preferences.end();
+    policy = next;
+    logStatus("POWER", "Policy set to %s", powerPolicyName(next));
+    wake(); // re-evaluated at the end of the next loop()
+}
+
+PowerLevel PowerGovernor::chooseLevel(bool busy, bool dark, unsigned long nowMs) const {
+    if (policy == PowerPolicy::PERFORMANCE || busy || nowMs - lastActivityMs < IDLE_AFTER_MS) {
+        return PowerLevel::ACTIVE;
+    }
+    return dark && policy == PowerPolicy::SAVER ? PowerLevel::DARK : PowerLevel::IDLE;
+}
+
+void PowerGovernor::enterLevel(PowerLevel next, unsigned long nowMs) {
+    residencyMs[static_cast<uint8_t>(level)] += nowMs - levelSinceMs;
+    levelSinceMs = nowMs;
+    if (next == level) {
+        return;
+    }
+
+    const bool active = next == PowerLevel::ACTIVE;
+    if (pmAvailable) {
+        if (active) {
+            esp_pm_lock_acquire(cpuLock);
+        } else if (level == PowerLevel::ACTIVE) {
+            esp_pm_lock_release(cpuLock);
+        }
+        if (lightSleepAvailable && (next == PowerLevel::DARK) != lightSleepOn) {
+            configurePm(next == PowerLevel::DARK);
+        }
+    } else {
+        setCpuFrequencyMhz(active ? MAX_CPU_MHZ : IDLE_CPU_MHZ);
+    }
+    // Modem sleep delays inbound packets until the next DTIM beacon; that is
+    // the price of idling and why the first command after idle is slower.
+    WiFi.setSleep(active ? WIFI_PS_NONE : WIFI_PS_MIN_MODEM);
+
+    if (!active && level == PowerLevel::ACTIVE) {
+        idleEntries++;
+        measuring = false; // the wake changed no output (e.g. a status poll)
+    }
+    level = next;
+}
+
+void PowerGovernor::idle(bool busy, bool dark, unsigned long nowMs) {
+    enterLevel(chooseLevel(busy, dark, nowMs), nowMs);
+    if (level == PowerLevel::ACTIVE) {
+        delay(ACTIVE_TICK_MS);
+        wakePending = false;
+        return;
+    }
+
+    stallMonitor.setRenderIdle(true);
+    const bool woken = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IDLE_MAX_WAIT_MS)) > 0;
+    stallMonitor.setRenderIdle(false);
+
+    if (woken && wakePending) {
+        wakes++;
+        // Back to full speed before loop() renders whatever the command changed.
+        enterLevel(PowerLevel::ACTIVE, millis());
+    }
+    wakePending = false;
+}
+
+void PowerGovernor::notePwmWrite() {
+    if (!measuring) {
+        return;
+    }
+    measuring = false;
+    lastWakeUs = micros() - measuringFromUs;
+    if (lastWakeUs > maxWakeUs) {
+        maxWakeUs = lastWakeUs;
+    }
+    totalWakeUs += lastWakeUs;
+    measuredWakes++;
+}
+
+size_t PowerGovernor::writeJson(char *out, size_t maxLen) const {
+    uint32_t residency[3] = {residencyMs[0], residencyMs[1], residencyMs[2]};
+    residency[static_cast<uint8_t>(level)] += millis() - levelSinceMs;
+    int len = snprintf(out, maxLen,
+                       "{\"policy\":\"%s\",\"level\":\"%s\",\"cpuMhz\":%lu,\"pm\":\"%s\",\"lightSleep\":\"%s\","
+                       "\"residencyMs\":{\"active\":%lu,\"idle\":%lu,\"dark\":%lu},\"idleEntries\":%lu,"
+                       "\"usbHost\":%s,\"wakes\":%lu,"
+                       "\"wakeToPwmUs\":{\"count\":%lu,\"last\":%lu,\"avg\":%lu,\"max\":%lu}}",
+                       powerPolicyName(policy), LEVEL_NAMES[static_cast<uint8_t>(level)],
+                       static_cast<unsigned long>(getCpuFrequencyMhz()), pmAvailable ? "dfs" : "manual",
+                       !lightSleepAvailable ? "unsupported" : lightSleepOn ? "on" : "off",
+                       static_cast<unsigned long>(residency[0]), static_cast<unsigned long>(residency[1]),
+                       static_cast<unsigned long>(residency[2]), static_cast<unsigned long>(idleEntries),
+                       usbHost ? "true" : "false", static_cast<unsigned long>(wakes),
+                       static_cast<unsigned long>(measuredWakes),
+                       static_cast<unsigned long>(lastWakeUs),
+                       static_cast<unsigned long>(measuredWakes ? totalWakeUs / measuredWakes : 0),
+                       static_cast<unsigned long>(maxWakeUs));
+    return len < 0 ? 0 : static_cast<size_t>(len);
+}
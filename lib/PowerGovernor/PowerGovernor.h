@@ -0,0 +1,95 @@
+#ifndef POWER_GOVERNOR_H
+#define POWER_GOVERNOR_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_pm.h>
+
+enum class PowerPolicy : uint8_t {
+    PERFORMANCE, // never idles: 160 MHz, radio always on, loop polls every 2 ms
+    BALANCED,    // idles at 80 MHz with modem sleep while nothing animates
+    SAVER,       // as BALANCED, plus automatic light sleep while the LEDs are dark
+};
+
+enum class PowerLevel : uint8_t {
+    ACTIVE,
+    IDLE, // lit but static: PWM keeps running, CPU and radio slow down
+    DARK, // all channels at 0: light sleep allowed (SAVER only)
+};
+
+const char *powerPolicyName(PowerPolicy policy);
+bool parsePowerPolicy(const char *value, PowerPolicy &out);
+
+// Replaces the fixed delay at the end of loop(). While the lamp is animating
+// (party mode, scheduler fades) or was commanded recently it keeps the old
+// 2 ms cadence at full clock. Otherwise loop() blocks on a task notification
+// until wake() or the next housekeeping deadline, so FreeRTOS can idle
+// (and light sleep, where the SDK allows it) instead of spinning.
+class PowerGovernor {
+public:
+    static constexpr uint32_t ACTIVE_TICK_MS = 2;
+    static constexpr uint32_t IDLE_MAX_WAIT_MS = 500; // keeps schedules, MQTT and heartbeats on time
+    static constexpr uint32_t IDLE_AFTER_MS = 3000;   // hysteresis after the last command
+    static constexpr uint32_t MAX_CPU_MHZ = 160;
+    static constexpr uint32_t IDLE_CPU_MHZ = 80;      // lowest clock that keeps APB, and so LEDC, at 80 MHz
+
+    void begin();
+
+    // Any task: a network command arrived, go active right away.
+    void wake();
+
+    // End of loop(): busy = something is animating, dark = all outputs off.
+    void idle(bool busy, bool dark, unsigned long nowMs);
+
+    // After every PWM update: the first one after a wake from idle ends the
+    // command-to-output latency measurement.
+    void notePwmWrite();
+
+    // Light sleep stops the USB-Serial-JTAG PHY and the host drops the port,
+    // so a no-light-sleep lock is held while a host is attached.
+    void setUsbHost(bool present);
+
+    void setPolicy(PowerPolicy policy);
+    PowerPolicy getPolicy() const { return policy; }
+    PowerLevel getLevel() const { return level; }
+
+    size_t writeJson(char *out, size_t maxLen) const;
+
+private:
+    Preferences preferences;
+    PowerPolicy policy = PowerPolicy::BALANCED;
+    PowerLevel level = PowerLevel::ACTIVE;
+    TaskHandle_t loopTask = nullptr;
+
+    // esp_pm is only usable when the SDK was built with CONFIG_PM_ENABLE;
+    // otherwise the clock is switched by hand with setCpuFrequencyMhz().
+    bool pmAvailable = false;
+    bool lightSleepAvailable = false;
+    bool lightSleepOn = false;
+    esp_pm_lock_handle_t cpuLock = nullptr;
+    esp_pm_lock_handle_t usbLock = nullptr;
+    bool usbHost = false;
+
+    volatile unsigned long lastActivityMs = 0;
+    volatile uint32_t wakeRequestedUs = 0;
+    volatile bool wakePending = false;
+    volatile uint32_t measuringFromUs = 0;
+    volatile bool measuring = false; // woken while idle, no PWM write yet
+
+    unsigned long levelSinceMs = 0;
+    uint32_t residencyMs[3] = {};
+    uint32_t idleEntries = 0;
+    uint32_t wakes = 0;
+    uint32_t measuredWakes = 0; // wakes followed by a PWM write
+    uint32_t lastWakeUs = 0;
+    uint32_t maxWakeUs = 0;
+    uint64_t totalWakeUs = 0;
+
+    PowerLevel chooseLevel(bool busy, bool dark, unsigned long nowMs) const;
+    void enterLevel(PowerLevel next, unsigned long nowMs);
+    void configurePm(bool lightSleep);
+};
+
+extern PowerGovernor powerGovernor;
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include <Arduino.h>
+#include <strings.h>
+
+// Preset colors in 11-bit PWM units, shared by the web API and the scheduler.
+struct Scene {
+    const char *name;
+    int red;
+    int green;
+    int blue;
+};
+
+static constexpr Scene SCENES[] = {
+    {"sunset", 1900, 750, 180},
+    {"ocean", 250, 1100, 1900},
+    {"forest", 250, 1600, 450},
+    {"focus", 1450, 1500, 1400},
+    {"calm", 900, 1050, 1200},
+    {"off", 0, 0, 0},
+};
+
+static constexpr size_t SCENE_COUNT = sizeof(SCENES) / sizeof(SCENES[0]);
+
+// Case-insensitive lookup; returns -1 for unknown scenes.
+inline int findScene(const char *name) {
+    if (name == nullptr) {
+        return -1;
+    }
+    for (size_t i = 0; i < SCENE_COUNT; i++) {
+        if (strcasecmp(name, SCENES[i].name) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+#endif
@@ -0,0 +1,332 @@
+#include "Scheduler.h"
+#include <sys/time.h>
+#include <time.h>
+#include "Scenes.h"
+#include "DebugLog.h"
+#include "Trace.h"
+
+#ifdef ARDUINO
+// Guards entries/heap: handlers edit them on async_tcp, tick() on the loop.
+// Nothing inside may log or touch NVS.
+static portMUX_TYPE schedMux = portMUX_INITIALIZER_UNLOCKED;
+#define SCHED_LOCK() portENTER_CRITICAL(&schedMux)
+#define SCHED_UNLOCK() portEXIT_CRITICAL(&schedMux)
+#else
+#define SCHED_LOCK()
+#define SCHED_UNLOCK()
+#endif
+
+void Scheduler::begin() {
+    preferences.begin("sched", true);
+    utcOffset = preferences.getShort("utcOffset", 0);
+    const bool layoutMatches = preferences.getUChar("layout", LAYOUT_VERSION) == LAYOUT_VERSION &&
+                               preferences.getBytesLength("entries") == sizeof(entries);
+    if (layoutMatches) {
+        preferences.getBytes("entries", entries, sizeof(entries));
+    } else {
+        memset(entries, 0, sizeof(entries)); // written by another firmware version; start clean
+    }
+    preferences.end();
+
+    heapSize = 0;
+    for (size_t slot = 0; slot < MAX_ENTRIES; slot++) {
+        if (entries[slot].id == 0) {
+            continue;
+        }
+        if (entries[slot].id >= nextId) {
+            nextId = entries[slot].id == 255 ? 1 : entries[slot].id + 1;
+        }
+        heap[heapSize] = static_cast<uint8_t>(slot);
+        siftUp(heapSize++);
+    }
+    // Repeats that fell due while the lamp was off are skipped, not fired
+    // late; if the clock is lost too, setClock() does this once it is set.
+    if (clockValid() && rollForward(now())) {
+        logStatus("SCHED", "Skipped repeats missed while the clock was stopped");
+        persist();
+    }
+    logStatus("SCHED", "Loaded %u schedules, clock %s", static_cast<unsigned>(heapSize),
+              clockValid() ? "valid" : "not set");
+}
+
+bool Scheduler::clockValid() {
+    return now() >= MIN_VALID_EPOCH;
+}
+
+uint32_t Scheduler::now() {
+    return static_cast<uint32_t>(time(nullptr));
+}
+
+void Scheduler::setClock(uint32_t epoch, int16_t offsetMinutes) {
+    const bool wasValid = clockValid();
+    struct timeval tv = {static_cast<time_t>(epoch), 0};
+    settimeofday(&tv, nullptr);
+    SCHED_LOCK();
+    const bool rolled = !wasValid && rollForward(now());
+    utcOffset = offsetMinutes;
+    dirty = true;
+    SCHED_UNLOCK();
+    if (rolled) {
+        logStatus("SCHED", "Skipped repeats missed while the clock was stopped");
+    }
+    logStatus("SCHED", "Clock set to %lu (UTC%+d min)", static_cast<unsigned long>(epoch), utcOffset);
+}
+
+uint32_t Scheduler::nextDailyAt(uint8_t hour, uint8_t minute) const {
+    const uint32_t day = 86400UL;
+    uint32_t current = now();
+    uint32_t local = current + utcOffset * 60;
+    uint32_t target = hour * 3600UL + minute * 60UL;
+    uint32_t delta = (target + day - local % day) % day;
+    return current + (delta == 0 ? day : delta);
+}
+
+void Scheduler::siftUp(size_t pos) {
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!earlier(pos, parent)) {
+            break;
+        }
+        uint8_t tmp = heap[pos];
+        heap[pos] = heap[parent];
+        heap[parent] = tmp;
+        pos = parent;
+    }
+}
+
+void Scheduler::siftDown(size_t pos) {
+    for (;;) {
+        size_t left = pos * 2 + 1;
+        size_t right = left + 1;
+        size_t smallest = pos;
+        if (left < heapSize && earlier(left, smallest)) {
+            smallest = left;
+        }
+        if (right < heapSize && earlier(right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == pos) {
+            return;
+        }
+        uint8_t tmp = heap[pos];
+        heap[pos] = heap[smallest];
+        heap[smallest] = tmp;
+        pos = smallest;
+    }
+}
+
+void Scheduler::removeAt(size_t pos) {
+    entries[heap[pos]].id = 0;
+    heap[pos] = heap[--heapSize];
+    if (pos < heapSize) {
+        siftDown(pos);
+        siftUp(pos);
+    }
+}
+
+void Scheduler::rebuildHeap() {
+    for (size_t pos = heapSize / 2; pos-- > 0;) {
+        siftDown(pos);
+    }
+}
+
+// Moves every overdue repeating entry to its next occurrence after `current`
+// without firing it. One-shots stay due and fire on the next tick.
+bool Scheduler::rollForward(uint32_t current) {
+    bool changed = false;
+    for (size_t pos = 0; pos < heapSize; pos++) {
+        ScheduleEntry &entry = entries[heap[pos]];
+        if (entry.period != 0 && entry.nextFire <= current) {
+            entry.nextFire += ((current - entry.nextFire) / entry.period + 1) * entry.period;
+            changed = true;
+        }
+    }
+    if (changed) {
+        rebuildHeap();
+    }
+    return changed;
+}
+
+// Ids wrap at 255; skip any still held by a live entry.
+uint8_t Scheduler::allocateId() {
+    for (;;) {
+        const uint8_t id = nextId;
+        nextId = nextId == 255 ? 1 : nextId + 1;
+        bool taken = false;
+        for (size_t pos = 0; pos < heapSize && !taken; pos++) {
+            taken = entries[heap[pos]].id == id;
+        }
+        if (!taken) {
+            return id;
+        }
+    }
+}
+
+uint8_t Scheduler::add(const ScheduleEntry &entry) {
+    SCHED_LOCK();
+    if (heapSize >= MAX_ENTRIES) {
+        SCHED_UNLOCK();
+        return 0;
+    }
+    size_t slot = 0;
+    while (entries[slot].id != 0) {
+        slot++;
+    }
+
+    const uint8_t id = allocateId();
+    entries[slot] = entry;
+    entries[slot].id = id;
+    heap[heapSize] = static_cast<uint8_t>(slot);
+    siftUp(heapSize++);
+    dirty = true;
+    SCHED_UNLOCK();
+    return id;
+}
+
+bool Scheduler::remove(uint8_t id) {
+    bool found = false;
+    SCHED_LOCK();
+    for (size_t pos = 0; pos < heapSize && !found; pos++) {
+        if (entries[heap[pos]].id == id) {
+            removeAt(pos);
+            dirty = true;
+            found = true;
+        }
+    }
+    SCHED_UNLOCK();
+    return found;
+}
+
+void Scheduler::clear() {
+    SCHED_LOCK();
+    memset(entries, 0, sizeof(entries));
+    heapSize = 0;
+    dirty = true;
+    SCHED_UNLOCK();
+}
+
+size_t Scheduler::copyEntries(ScheduleEntry *out, size_t max) const {
+    SCHED_LOCK();
+    size_t count = 0;
+    for (; count < heapSize && count < max; count++) {
+        out[count] = entries[heap[count]];
+    }
+    SCHED_UNLOCK();
+    return count;
+}
+
+void Scheduler::tick(unsigned long nowMs) {
+    if (fade.isActive()) {
+        if (stateHandler.getCurrentMode() != OperationMode::WIFI) {
+            fade.cancel();
+        } else {
+            int r, g, b, lastR, lastG, lastB;
+            fade.step(nowMs, r, g, b);
+            ledController.getRequestedValues(lastR, lastG, lastB);
+            // Only steps that move the output are traced, so a slow fade does not flood the ring.
+            if (r != lastR || g != lastG || b != lastB) {
+                traceEvent(TraceEvent::COMMAND, static_cast<uint8_t>(TraceCommand::FADE), static_cast<uint16_t>(r),
+                           (static_cast<uint32_t>(g) << 16) | static_cast<uint32_t>(b));
+                ledController.setPWMDirectly(r, g, b);
+            }
+        }
+    }
+
+    const bool clockSet = clockValid();
+    const uint32_t current = now();
+    for (;;) {
+        // Fired from a copy so the handlers are not locked out while it runs.
+        ScheduleEntry due;
+        SCHED_LOCK();
+        const bool found = clockSet && heapSize > 0 && entries[heap[0]].nextFire <= current;
+        if (found) {
+            ScheduleEntry &entry = entries[heap[0]];
+            due = entry;
+            if (entry.period == 0) {
+                removeAt(0);
+                dirty = true;
+            } else {
+                // Fires once even if the loop stalled past several occurrences.
+                // Not persisted: begin() and setClock() skip repeats that a
+                // reboot finds overdue, so the stored nextFire may lag.
+                uint32_t missed = (current - entry.nextFire) / entry.period + 1;
+                entry.nextFire += missed * entry.period;
+                siftDown(0);
+            }
+        }
+        SCHED_UNLOCK();
+        if (!found) {
+            break;
+        }
+        fire(due, nowMs);
+    }
+    if (dirty) {
+        persist();
+    }
+}
+
+// The one field trace_replay needs to redo the action.
+static uint32_t traceArgument(const ScheduleEntry &entry) {
+    switch (entry.action) {
+    case ScheduleAction::SCENE:
+        return entry.scene;
+    case ScheduleAction::MODE:
+        return static_cast<uint32_t>(entry.mode);
+    case ScheduleAction::PARTY:
+        return static_cast<uint32_t>(entry.partyHz * 1000.0f + 0.5f);
+    case ScheduleAction::FADE:
+        return entry.fadeSeconds;
+    }
+    return 0;
+}
+
+void Scheduler::fire(const ScheduleEntry &entry, unsigned long nowMs) {
+    logStatus("SCHED", "Firing schedule id=%u action=%u", entry.id, static_cast<unsigned>(entry.action));
+    traceEvent(TraceEvent::COMMAND, static_cast<uint8_t>(TraceCommand::SCHEDULE), static_cast<uint16_t>(entry.action),
+               traceArgument(entry));
+    switch (entry.action) {
+    case ScheduleAction::SCENE:
+        if (entry.scene < SCENE_COUNT) {
+            const Scene &scene = SCENES[entry.scene];
+            fade.cancel();
+            stateHandler.setMode(OperationMode::WIFI);
+            ledController.setPWMDirectly(scene.red, scene.green, scene.blue);
+        }
+        break;
+    case ScheduleAction::MODE:
+        fade.cancel();
+        stateHandler.setMode(entry.mode);
+        if (entry.mode == OperationMode::OFF) {
+            ledController.setPWMDirectly(0, 0, 0);
+        }
+        break;
+    case ScheduleAction::PARTY:
+        fade.cancel();
+        stateHandler.setPartyHz(entry.partyHz);
+        stateHandler.setMode(OperationMode::PARTY);
+        break;
+    case ScheduleAction::FADE: {
+        int r, g, b;
+        ledController.getRequestedValues(r, g, b);
+        stateHandler.setMode(OperationMode::WIFI);
+        fade.start(r, g, b, entry.red, entry.green, entry.blue, entry.fadeSeconds * 1000UL, nowMs);
+        break;
+    }
+    }
+}
+
+// Loop task only (and begin()); the table is copied out so the flash write
+// runs without holding the lock.
+void Scheduler::persist() {
+    ScheduleEntry saved[MAX_ENTRIES];
+    SCHED_LOCK();
+    memcpy(saved, entries, sizeof(saved));
+    const int16_t offset = utcOffset;
+    dirty = false;
+    SCHED_UNLOCK();
+    preferences.begin("sched", false);
+    preferences.putUChar("layout", LAYOUT_VERSION);
+    preferences.putBytes("entries", saved, sizeof(saved));
+    preferences.putShort("utcOffset", offset);
+    preferences.end();
+}
@@ -0,0 +1,155 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include "LEDController.h"
+#include "State.h"
+
+enum class ScheduleAction : uint8_t {
+    SCENE,
+    MODE,
+    PARTY,
+    FADE,
+};
+
+// Fixed-size, trivially copyable so the whole table persists as one NVS blob.
+struct ScheduleEntry {
+    uint8_t id;            // 1..255, 0 = free slot
+    ScheduleAction action;
+    uint8_t scene;         // SCENE: index into SCENES
+    OperationMode mode;    // MODE
+    float partyHz;         // PARTY
+    uint16_t red;          // FADE target, 11-bit PWM
+    uint16_t green;
+    uint16_t blue;
+    uint32_t fadeSeconds;  // FADE duration
+    uint32_t nextFire;     // wall-clock epoch seconds (UTC)
+    uint32_t period;       // seconds between repeats, 0 = one-shot
+};
+
+// Linear RGB ramp stepped from the render loop.
+class LightFade {
+public:
+    void start(int fromR, int fromG, int fromB, int toR, int toG, int toB,
+               unsigned long durationMs, unsigned long nowMs) {
+        from[0] = fromR; from[1] = fromG; from[2] = fromB;
+        to[0] = toR; to[1] = toG; to[2] = toB;
+        startMs = nowMs;
+        duration = durationMs > 0 ? durationMs : 1;
+        active = true;
+    }
+
+    void cancel() {
+        active = false;
+    }
+
+    bool isActive() const {
+        return active;
+    }
+
+    void target(int &r, int &g, int &b) const {
+        r = to[0];
+        g = to[1];
+        b = to[2];
+    }
+
+    // Returns false once the fade is finished or cancelled.
+    bool step(unsigned long nowMs, int &r, int &g, int &b) {
+        if (!active) {
+            return false;
+        }
+        unsigned long elapsed = nowMs - startMs;
+        if (elapsed >= duration) {
+            elapsed = duration;
+            active = false;
+        }
+        float t = static_cast<float>(elapsed) / static_cast<float>(duration);
+        r = from[0] + static_cast<int>((to[0] - from[0]) * t);
+        g = from[1] + static_cast<int>((to[1] - from[1]) * t);
+        b = from[2] + static_cast<int>((to[2] - from[2]) * t);
+        return true;
+    }
+
+private:
+    int from[3] = {0, 0, 0};
+    int to[3] = {0, 0, 0};
+    unsigned long startMs = 0;
+    unsigned long duration = 1;
+    bool active = false;
+};
+
+// On-device automation. Entries sit in a binary min-heap keyed by their next
+// fire time, so each render-loop tick only compares against the heap top and
+// firing costs O(log n) regardless of how many schedules exist.
+// The web handlers edit the table from the async_tcp task while tick() runs
+// on the loop task; the heap is guarded by a critical section and NVS is only
+// written from tick().
+class Scheduler {
+public:
+    static constexpr size_t MAX_ENTRIES = 16;
+    // Bump whenever ScheduleEntry changes; a stored table with another
+    // version or size is dropped instead of being read as garbage.
+    static constexpr uint8_t LAYOUT_VERSION = 1;
+    // Anything earlier means the wall clock has not been set since power loss.
+    static constexpr uint32_t MIN_VALID_EPOCH = 1700000000UL;
+    // Shortest repeat accepted from the API.
+    static constexpr uint32_t MIN_PERIOD_S = 60;
+
+    Scheduler(LampLEDController &led, StateHandler &state) : ledController(led), stateHandler(state) {}
+
+    void begin();
+
+    // Called every render tick. Fires due entries, advances any fade and
+    // saves edits made since the last tick.
+    void tick(unsigned long nowMs);
+
+    uint8_t add(const ScheduleEntry &entry);
+    bool remove(uint8_t id);
+    void clear();
+
+    size_t size() const { return heapSize; }
+    // Copies up to `max` live entries (heap order) and returns how many.
+    size_t copyEntries(ScheduleEntry *out, size_t max) const;
+
+    static bool clockValid();
+    static uint32_t now();
+    // Sets the wall clock (held by the RTC across resets) and the local offset.
+    void setClock(uint32_t epoch, int16_t offsetMinutes);
+    int16_t utcOffsetMinutes() const { return utcOffset; }
+    // Next UTC epoch at which local time reads hh:mm.
+    uint32_t nextDailyAt(uint8_t hour, uint8_t minute) const;
+
+    void cancelFade() { fade.cancel(); }
+    bool isFading() const { return fade.isActive(); }
+    // The color a running fade ends on (11-bit); false when none is running.
+    bool fadeTarget(int &r, int &g, int &b) const {
+        fade.target(r, g, b);
+        return fade.isActive();
+    }
+
+private:
+    LampLEDController &ledController;
+    StateHandler &stateHandler;
+    Preferences preferences;
+    LightFade fade;
+
+    ScheduleEntry entries[MAX_ENTRIES] = {};
+    uint8_t heap[MAX_ENTRIES] = {};   // slot indices ordered by nextFire
+    size_t heapSize = 0;
+    uint8_t nextId = 1;
+    int16_t utcOffset = 0;
+    volatile bool dirty = false;      // table or offset changed, persisted by tick()
+
+    bool earlier(size_t a, size_t b) const { return entries[heap[a]].nextFire < entries[heap[b]].nextFire; }
+    void siftUp(size_t pos);
+    void siftDown(size_t pos);
+    void removeAt(size_t pos);
+    void rebuildHeap();
+    bool rollForward(uint32_t current);
+    uint8_t allocateId();
+    void fire(const ScheduleEntry &entry, unsigned long nowMs);
+    void persist();
+};
+
+#endif
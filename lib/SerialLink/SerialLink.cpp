@@ -0,0 +1,141 @@
+#include "SerialLink.h"
+
+static uint16_t readU16(const uint8_t *data) {
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+static uint8_t *putU32(uint8_t *out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+    out[2] = static_cast<uint8_t>(value >> 16);
+    out[3] = static_cast<uint8_t>(value >> 24);
+    return out + 4;
+}
+
+size_t SerialLink::poll() {
+    size_t handled = 0;
+    for (size_t budget = MAX_BYTES_PER_POLL; budget > 0 && port.available() > 0; budget--) {
+        const int byte = port.read();
+        if (byte < 0 || !reader.push(static_cast<uint8_t>(byte))) {
+            continue;
+        }
+        handled++;
+
+        const uint8_t type = reader.type();
+        if (type & SERIAL_REPLY) {
+            continue; // our own reply looped back by a terminal
+        }
+        uint8_t reply[SERIAL_MAX_PAYLOAD - 1];
+        size_t replyLen = 0;
+        const SerialStatus status = dispatch(static_cast<SerialCommand>(type & SERIAL_TYPE_MASK), reader.payload(),
+                                             reader.payloadLength(), reply, replyLen);
+        // Errors are always reported, even for fire-and-forget frames.
+        if (!(type & SERIAL_NO_ACK) || status != SerialStatus::OK) {
+            sendReply(type & SERIAL_TYPE_MASK, reader.seq(), status, reply, replyLen);
+        }
+    }
+    return handled;
+}
+
+SerialStatus SerialLink::dispatch(SerialCommand command, const uint8_t *payload, size_t len, uint8_t *reply,
+                                  size_t &replyLen) {
+    switch (command) {
+    case SerialCommand::PING:
+        memcpy(reply, payload, len < SERIAL_MAX_PAYLOAD - 1 ? len : SERIAL_MAX_PAYLOAD - 1);
+        replyLen = len < SERIAL_MAX_PAYLOAD - 1 ? len : SERIAL_MAX_PAYLOAD - 1;
+        return SerialStatus::OK;
+
+    case SerialCommand::STATUS:
+        replyLen = writeStatus(reply);
+        return SerialStatus::OK;
+
+    case SerialCommand::COLOR:
+        if (len != 3) {
+            return SerialStatus::BAD_LENGTH;
+        }
+        commands.setColor(payload[0], payload[1], payload[2]);
+        return SerialStatus::OK;
+
+    case SerialCommand::MODE:
+        if (len != 1) {
+            return SerialStatus::BAD_LENGTH;
+        }
+        if (payload[0] > static_cast<uint8_t>(OperationMode::OFF)) {
+            return SerialStatus::BAD_VALUE;
+        }
+        commands.setMode(static_cast<OperationMode>(payload[0]));
+        return SerialStatus::OK;
+
+    case SerialCommand::SCENE: {
+        char name[SERIAL_MAX_PAYLOAD + 1];
+        memcpy(name, payload, len);
+        name[len] = '\0';
+        return commands.applyScene(name) ? SerialStatus::OK : SerialStatus::BAD_VALUE;
+    }
+
+    case SerialCommand::PARTY_HZ:
+        if (len != 2) {
+            return SerialStatus::BAD_LENGTH;
+        }
+        commands.setPartyHz(readU16(payload) / 1000.0f);
+        return SerialStatus::OK;
+
+    case SerialCommand::UNLOCK:
+        commands.unlock();
+        return SerialStatus::OK;
+
+    case SerialCommand::RESET:
+        commands.resetToSafeMode();
+        return SerialStatus::OK;
+
+    case SerialCommand::FRAME: {
+        if (len != LAMP_LED_CHANNELS * 2) {
+            return SerialStatus::BAD_LENGTH;
+        }
+        int values[LAMP_LED_CHANNELS];
+        for (size_t i = 0; i < LAMP_LED_CHANNELS; i++) {
+            values[i] = readU16(payload + i * 2);
+            if (values[i] > 2047) {
+                return SerialStatus::BAD_VALUE;
+            }
+        }
+        commands.setChannels(values);
+        return SerialStatus::OK;
+    }
+    }
+    return SerialStatus::UNKNOWN_COMMAND;
+}
+
+// mode, unlocked, channel count, party mHz (u16), r, g, b (0-255),
+// frames (u32), bad CRC (u32), malformed (u32), overflow (u32)
+size_t SerialLink::writeStatus(uint8_t *out) const {
+    uint8_t *p = out;
+    *p++ = static_cast<uint8_t>(commands.getMode());
+    *p++ = commands.isUnlocked() ? 1 : 0;
+    *p++ = LAMP_LED_CHANNELS;
+    const uint16_t mHz = static_cast<uint16_t>(commands.getPartyHz() * 1000.0f + 0.5f);
+    *p++ = static_cast<uint8_t>(mHz);
+    *p++ = static_cast<uint8_t>(mHz >> 8);
+    int r, g, b;
+    commands.getColor8(r, g, b);
+    *p++ = static_cast<uint8_t>(r);
+    *p++ = static_cast<uint8_t>(g);
+    *p++ = static_cast<uint8_t>(b);
+    const SerialFrameReader::Errors &counts = reader.errorCounts();
+    p = putU32(p, reader.frameCount());
+    p = putU32(p, counts.badCrc);
+    p = putU32(p, counts.malformed);
+    p = putU32(p, counts.overflow);
+    return static_cast<size_t>(p - out);
+}
+
+void SerialLink::sendReply(uint8_t type, uint8_t seq, SerialStatus status, const uint8_t *data, size_t len) {
+    uint8_t payload[SERIAL_MAX_PAYLOAD];
+    payload[0] = static_cast<uint8_t>(status);
+    memcpy(payload + 1, data, len);
+    uint8_t frame[SERIAL_MAX_ENCODED + 2];
+    const size_t frameLen = serialEncodeFrame(type | SERIAL_REPLY, seq, payload, len + 1, frame);
+    // One write() per frame: the CDC driver holds its TX lock for the whole
+    // call, so log lines from other tasks land before or after it, never inside.
+    port.write(frame, frameLen);
+}
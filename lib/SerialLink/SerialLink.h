@@ -0,0 +1,36 @@
+#ifndef SERIAL_LINK_H
+#define SERIAL_LINK_H
+
+#include <Arduino.h>
+#include "LampCommands.h"
+#include "SerialProtocol.h"
+
+// Binary command channel on the USB CDC port, next to the log output.
+// Frames are decoded and applied on the loop task, so a streamed FRAME is
+// on the LEDs before poll() returns, with no queue or task switch between
+// the USB buffer and the LEDC registers.
+class SerialLink {
+public:
+    // Bounds the work per loop iteration; the rest waits in the CDC buffer.
+    static constexpr size_t MAX_BYTES_PER_POLL = 512;
+
+    SerialLink(Stream &port, LampCommands &commands) : port(port), commands(commands) {}
+
+    // Loop task. Returns the number of frames handled.
+    size_t poll();
+
+    uint32_t framesHandled() const { return reader.frameCount(); }
+    const SerialFrameReader::Errors &errors() const { return reader.errorCounts(); }
+
+private:
+    Stream &port;
+    LampCommands &commands;
+    SerialFrameReader reader;
+
+    SerialStatus dispatch(SerialCommand command, const uint8_t *payload, size_t len, uint8_t *reply,
+                          size_t &replyLen);
+    size_t writeStatus(uint8_t *out) const;
+    void sendReply(uint8_t type, uint8_t seq, SerialStatus status, const uint8_t *data, size_t len);
+};
+
+#endif
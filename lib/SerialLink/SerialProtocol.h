@@ -0,0 +1,180 @@
+#ifndef SERIAL_PROTOCOL_H
+#define SERIAL_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Binary control frames shared with the USB CDC log stream. Platform
+// independent so the pty stand-in in tools/ runs the same code.
+//
+// Wire format: 0x00, COBS(type, seq, payload..., crc16 lo, crc16 hi), 0x00
+//   - COBS guarantees no 0x00 inside a frame, so frames and log text split
+//     cleanly on 0x00; a chunk that fails COBS or CRC is treated as text.
+//   - crc16 is CRC-16/CCITT-FALSE over type, seq and payload.
+//   - Replies echo seq with SERIAL_REPLY set on the type and a status byte
+//     first in the payload. SERIAL_NO_ACK on a command suppresses the reply.
+
+enum class SerialCommand : uint8_t {
+    PING = 0x01,     // payload echoed back
+    STATUS = 0x02,   // reply: see SerialLink::writeStatus
+    COLOR = 0x03,    // r, g, b (0-255), same as POST /postRGB
+    MODE = 0x04,     // OperationMode
+    SCENE = 0x05,    // scene name, no terminator
+    PARTY_HZ = 0x06, // u16 mHz
+    UNLOCK = 0x07,
+    RESET = 0x08,
+    FRAME = 0x10,    // u16 per channel (0-2047), channel-map order
+};
+
+enum class SerialStatus : uint8_t {
+    OK = 0,
+    BAD_LENGTH,
+    BAD_VALUE,
+    UNKNOWN_COMMAND,
+};
+
+static constexpr uint8_t SERIAL_NO_ACK = 0x40;
+static constexpr uint8_t SERIAL_REPLY = 0x80;
+static constexpr uint8_t SERIAL_TYPE_MASK = 0x3F;
+static constexpr size_t SERIAL_MAX_PAYLOAD = 48;
+static constexpr size_t SERIAL_MAX_RAW = SERIAL_MAX_PAYLOAD + 4; // type, seq, crc
+static constexpr size_t SERIAL_MAX_ENCODED = SERIAL_MAX_RAW + SERIAL_MAX_RAW / 254 + 1;
+
+inline uint16_t serialCrc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Returns the encoded length (no delimiters); out needs len + len/254 + 1 bytes.
+inline size_t cobsEncode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t codeAt = 0;
+    size_t write = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[codeAt] = code;
+            codeAt = write++;
+            code = 1;
+            continue;
+        }
+        out[write++] = in[i];
+        if (++code == 0xFF) {
+            out[codeAt] = code;
+            codeAt = write++;
+            code = 1;
+        }
+    }
+    out[codeAt] = code;
+    return write;
+}
+
+// Decodes in place-compatible buffers; returns 0 for malformed input.
+inline size_t cobsDecode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t read = 0;
+    size_t write = 0;
+    while (read < len) {
+        const uint8_t code = in[read++];
+        if (code == 0 || read + code - 1 > len) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            out[write++] = in[read++];
+        }
+        if (code != 0xFF && read < len) {
+            out[write++] = 0;
+        }
+    }
+    return write;
+}
+
+// Builds a complete delimited frame; returns its length, 0 if payload is too long.
+inline size_t serialEncodeFrame(uint8_t type, uint8_t seq, const uint8_t *payload, size_t len, uint8_t *out) {
+    if (len > SERIAL_MAX_PAYLOAD) {
+        return 0;
+    }
+    uint8_t raw[SERIAL_MAX_RAW];
+    raw[0] = type;
+    raw[1] = seq;
+    if (len) {
+        memcpy(raw + 2, payload, len);
+    }
+    const uint16_t crc = serialCrc16(raw, len + 2);
+    raw[len + 2] = static_cast<uint8_t>(crc);
+    raw[len + 3] = static_cast<uint8_t>(crc >> 8);
+
+    out[0] = 0;
+    const size_t encoded = cobsEncode(raw, len + 4, out + 1);
+    out[encoded + 1] = 0;
+    return encoded + 2;
+}
+
+// Byte-at-a-time frame parser. Text between frames (logs echoed back by a
+// terminal, line noise) is discarded and counted, never mistaken for a frame.
+class SerialFrameReader {
+public:
+    // Returns true when a valid frame has just completed.
+    bool push(uint8_t byte) {
+        if (byte != 0) {
+            if (fill < sizeof(encoded)) {
+                encoded[fill++] = byte;
+            } else {
+                overflowed = true;
+            }
+            return false;
+        }
+        if (fill == 0) {
+            return false; // back-to-back delimiters
+        }
+        const bool tooLong = overflowed;
+        const size_t received = fill;
+        fill = 0;
+        overflowed = false;
+        if (tooLong) {
+            errors.overflow++;
+            return false;
+        }
+        rawLen = cobsDecode(encoded, received, raw);
+        if (rawLen < 4) {
+            errors.malformed++;
+            return false;
+        }
+        const uint16_t crc = static_cast<uint16_t>(raw[rawLen - 2] | (raw[rawLen - 1] << 8));
+        if (serialCrc16(raw, rawLen - 2) != crc) {
+            errors.badCrc++;
+            return false;
+        }
+        frames++;
+        return true;
+    }
+
+    uint8_t type() const { return raw[0]; }
+    uint8_t seq() const { return raw[1]; }
+    const uint8_t *payload() const { return raw + 2; }
+    size_t payloadLength() const { return rawLen - 4; }
+
+    struct Errors {
+        uint32_t malformed;
+        uint32_t badCrc;
+        uint32_t overflow;
+    };
+    const Errors &errorCounts() const { return errors; }
+    uint32_t frameCount() const { return frames; }
+
+private:
+    uint8_t encoded[SERIAL_MAX_ENCODED];
+    uint8_t raw[SERIAL_MAX_ENCODED];
+    size_t fill = 0;
+    size_t rawLen = 0;
+    bool overflowed = false;
+    uint32_t frames = 0;
+    Errors errors = {};
+};
+
+#endif
@@ -0,0 +1,269 @@
+#include "StallMonitor.h"
+#include <esp_attr.h>
+#include <esp_system.h>
+#include "DebugLog.h"
+
+StallMonitor stallMonitor;
+
+static portMUX_TYPE stallMux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const SOURCE_NAMES[STALL_SOURCE_COUNT] = {"render", "async_tcp", "monitor"};
+
+// Compact record kept in RTC memory, which is not cleared by watchdog or
+// panic resets, so the next boot can say what the lamp was doing.
+struct StallBootRecord {
+    uint32_t magic;
+    uint32_t uptimeMs;
+    uint32_t renderAgeMs;
+    uint32_t callbackBusyMs;
+    uint32_t lastGapMs;
+    uint8_t lastSource;
+    uint8_t busiestPercent;
+    uint16_t tightestStack;
+    char busiestTask[16];
+    char tightestTask[16];
+};
+
+static constexpr uint32_t BOOT_RECORD_MAGIC = 0x53544C4C; // "STLL"
+RTC_NOINIT_ATTR static StallBootRecord bootRecord;
+
+void StallMonitor::begin(uint32_t thresholdMs) {
+    threshold = thresholdMs;
+    lastRenderMs = millis();
+    reportPreviousBoot();
+    memset(&bootRecord, 0, sizeof(bootRecord));
+    bootRecord.magic = BOOT_RECORD_MAGIC;
+    xTaskCreate(monitorTask, "stallmon", 3072, this, 4, nullptr);
+}
+
+void StallMonitor::reportPreviousBoot() {
+    esp_reset_reason_t reason = esp_reset_reason();
+    const bool watchdog = reason == ESP_RST_TASK_WDT || reason == ESP_RST_INT_WDT ||
+                          reason == ESP_RST_WDT || reason == ESP_RST_PANIC;
+    if (!watchdog || bootRecord.magic != BOOT_RECORD_MAGIC) {
+        return;
+    }
+    const StallBootRecord &r = bootRecord;
+    char busiest[24] = "n/a"; // no CPU figures without run-time stats
+    if (r.busiestTask[0]) {
+        snprintf(busiest, sizeof(busiest), "%.15s(%u%%)", r.busiestTask, r.busiestPercent);
+    }
+    logStatus("BOOT", "reset=%d after %lu ms: renderAge=%lu cbBusy=%lu last=%s/%lums busiest=%s stackMin=%.15s/%u",
+              static_cast<int>(reason), static_cast<unsigned long>(r.uptimeMs),
+              static_cast<unsigned long>(r.renderAgeMs), static_cast<unsigned long>(r.callbackBusyMs),
+              r.lastSource < STALL_SOURCE_COUNT ? SOURCE_NAMES[r.lastSource] : "none",
+              static_cast<unsigned long>(r.lastGapMs), busiest, r.tightestTask, r.tightestStack);
+}
+
+void StallMonitor::beatRender() {
+    const uint32_t now = millis();
+    const uint32_t gap = now - lastRenderMs;
+    lastRenderMs = now;
+    if (gap > threshold) {
+        // The monitor may already have counted this stall while it was ongoing.
+        note(StallSource::RENDER, gap, !renderFlagged);
+    }
+    renderFlagged = false;
+}
+
+void StallMonitor::setRenderIdle(bool idle) {
+    lastRenderMs = millis();
+    renderFlagged = false;
+    renderIdle = idle;
+}
+
+void StallMonitor::enterCallback() {
+    const uint32_t now = millis();
+    callbackStartMs = now ? now : 1;
+}
+
+void StallMonitor::exitCallback() {
+    const uint32_t busy = millis() - callbackStartMs;
+    callbackStartMs = 0;
+    if (busy > threshold) {
+        note(StallSource::ASYNC_TCP, busy, !callbackFlagged);
+    }
+    callbackFlagged = false;
+}
+
+void StallMonitor::note(StallSource source, uint32_t gapMs, bool newStall) {
+    portENTER_CRITICAL(&stallMux);
+    StallStats &s = stats[static_cast<size_t>(source)];
+    if (newStall) {
+        s.count++;
+    }
+    if (gapMs > s.worstMs) {
+        s.worstMs = gapMs;
+    }
+    s.lastGapMs = gapMs;
+    s.lastAtMs = millis();
+    bootRecord.lastSource = static_cast<uint8_t>(source);
+    bootRecord.lastGapMs = gapMs;
+    portEXIT_CRITICAL(&stallMux);
+
+    if (newStall) {
+        logStatus("STALL", "%s gap=%lu ms", SOURCE_NAMES[static_cast<size_t>(source)],
+                  static_cast<unsigned long>(gapMs));
+    }
+}
+
+void StallMonitor::check(uint32_t lateMs) {
+    const uint32_t now = millis();
+    if (lateMs > threshold) {
+        note(StallSource::MONITOR, lateMs, true);
+    }
+
+    const uint32_t renderAge = renderIdle ? 0 : now - lastRenderMs;
+    if (renderAge > threshold && !renderFlagged) {
+        renderFlagged = true;
+        note(StallSource::RENDER, renderAge, true);
+    }
+
+    const uint32_t start = callbackStartMs;
+    const uint32_t busy = start ? now - start : 0;
+    if (busy > threshold && !callbackFlagged) {
+        callbackFlagged = true;
+        note(StallSource::ASYNC_TCP, busy, true);
+    }
+
+    bootRecord.uptimeMs = now;
+    bootRecord.renderAgeMs = renderAge;
+    bootRecord.callbackBusyMs = busy;
+}
+
+void StallMonitor::sampleTasks() {
+#if configUSE_TRACE_FACILITY
+    TaskStatus_t status[MAX_TASKS];
+    uint32_t totalRuntime = 0;
+    const UBaseType_t n = uxTaskGetSystemState(status, MAX_TASKS, &totalRuntime);
+
+    TaskSample fresh[MAX_TASKS] = {};
+    uint32_t elapsed = 0;
+#if configGENERATE_RUN_TIME_STATS
+    for (UBaseType_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < taskCount; j++) {
+            if (tasks[j].taskNumber == status[i].xTaskNumber) {
+                elapsed += status[i].ulRunTimeCounter - tasks[j].runtime;
+                break;
+            }
+        }
+    }
+#endif
+
+    for (UBaseType_t i = 0; i < n; i++) {
+        TaskSample &t = fresh[i];
+        strncpy(t.name, status[i].pcTaskName, sizeof(t.name) - 1);
+        t.priority = static_cast<uint8_t>(status[i].uxCurrentPriority);
+        t.stackFreeMin = static_cast<uint16_t>(status[i].usStackHighWaterMark);
+        t.taskNumber = status[i].xTaskNumber;
+        t.runtime = status[i].ulRunTimeCounter;
+        t.cpuPercent = CPU_UNKNOWN; // until there is a previous sample to compare with
+        for (size_t j = 0; j < taskCount && elapsed > 0; j++) {
+            if (tasks[j].taskNumber == t.taskNumber) {
+                t.cpuPercent = static_cast<uint8_t>(
+                    (static_cast<uint64_t>(t.runtime - tasks[j].runtime) * 100) / elapsed);
+                break;
+            }
+        }
+    }
+
+    portENTER_CRITICAL(&stallMux);
+    memcpy(tasks, fresh, sizeof(tasks));
+    taskCount = n;
+    portEXIT_CRITICAL(&stallMux);
+#else
+    // Without the trace facility only stack high-water marks of known tasks
+    // are available.
+    static const char *const KNOWN[] = {"loopTask", "async_tcp", "wifi", "tiT", "stallmon", "IDLE"};
+    size_t n = 0;
+    for (size_t i = 0; i < sizeof(KNOWN) / sizeof(KNOWN[0]); i++) {
+        TaskHandle_t handle = xTaskGetHandle(KNOWN[i]);
+        if (!handle) {
+            continue;
+        }
+        TaskSample &t = tasks[n++];
+        strncpy(t.name, KNOWN[i], sizeof(t.name) - 1);
+        t.cpuPercent = CPU_UNKNOWN;
+        t.priority = static_cast<uint8_t>(uxTaskPriorityGet(handle));
+        t.stackFreeMin = static_cast<uint16_t>(uxTaskGetStackHighWaterMark(handle));
+    }
+    taskCount = n;
+#endif
+
+    size_t busiest = taskCount, tightest = 0;
+    for (size_t i = 0; i < taskCount; i++) {
+        if (tasks[i].cpuPercent != CPU_UNKNOWN && strncmp(tasks[i].name, "IDLE", 4) != 0 &&
+            (busiest == taskCount || tasks[i].cpuPercent > tasks[busiest].cpuPercent)) {
+            busiest = i;
+        }
+        if (tasks[i].stackFreeMin < tasks[tightest].stackFreeMin) {
+            tightest = i;
+        }
+    }
+    if (busiest < taskCount) {
+        memcpy(bootRecord.busiestTask, tasks[busiest].name, sizeof(bootRecord.busiestTask));
+        bootRecord.busiestPercent = tasks[busiest].cpuPercent;
+    }
+    if (taskCount > 0) {
+        memcpy(bootRecord.tightestTask, tasks[tightest].name, sizeof(bootRecord.tightestTask));
+        bootRecord.tightestStack = tasks[tightest].stackFreeMin;
+    }
+}
+
+void StallMonitor::monitorTask(void *arg) {
+    StallMonitor *self = static_cast<StallMonitor *>(arg);
+    TickType_t lastWake = xTaskGetTickCount();
+    uint32_t expected = millis() + CHECK_INTERVAL_MS;
+    uint32_t sinceSample = TASK_SAMPLE_INTERVAL_MS;
+    for (;;) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(CHECK_INTERVAL_MS));
+        const uint32_t now = millis();
+        const int32_t late = static_cast<int32_t>(now - expected);
+        expected = now + CHECK_INTERVAL_MS;
+        self->check(late > 0 ? static_cast<uint32_t>(late) : 0);
+
+        sinceSample += CHECK_INTERVAL_MS;
+        if (sinceSample >= TASK_SAMPLE_INTERVAL_MS) {
+            sinceSample = 0;
+            self->sampleTasks();
+        }
+    }
+}
+
+size_t StallMonitor::writeJson(char *out, size_t maxLen) {
+    StallStats snap[STALL_SOURCE_COUNT];
+    TaskSample taskSnap[MAX_TASKS];
+    size_t tasksNow;
+    portENTER_CRITICAL(&stallMux);
+    memcpy(snap, stats, sizeof(snap));
+    memcpy(taskSnap, tasks, sizeof(taskSnap));
+    tasksNow = taskCount;
+    portEXIT_CRITICAL(&stallMux);
+
+    size_t used = snprintf(out, maxLen, "{\"thresholdMs\":%lu,\"uptimeMs\":%lu,\"renderAgeMs\":%lu,\"stalls\":{",
+                           static_cast<unsigned long>(threshold), static_cast<unsigned long>(millis()),
+                           static_cast<unsigned long>(millis() - lastRenderMs));
+    for (size_t i = 0; i < STALL_SOURCE_COUNT && used < maxLen; i++) {
+        used += snprintf(out + used, maxLen - used,
+                         "%s\"%s\":{\"count\":%lu,\"worstMs\":%lu,\"lastMs\":%lu,\"lastAt\":%lu}", i ? "," : "",
+                         SOURCE_NAMES[i], static_cast<unsigned long>(snap[i].count),
+                         static_cast<unsigned long>(snap[i].worstMs), static_cast<unsigned long>(snap[i].lastGapMs),
+                         static_cast<unsigned long>(snap[i].lastAtMs));
+    }
+    if (used < maxLen) {
+        used += snprintf(out + used, maxLen - used, "},\"tasks\":[");
+    }
+    for (size_t i = 0; i < tasksNow && used < maxLen; i++) {
+        char cpu[5] = "null";
+        if (taskSnap[i].cpuPercent != CPU_UNKNOWN) {
+            snprintf(cpu, sizeof(cpu), "%u", taskSnap[i].cpuPercent);
+        }
+        used += snprintf(out + used, maxLen - used,
+                         "%s{\"name\":\"%.15s\",\"prio\":%u,\"cpu\":%s,\"stackFree\":%u}", i ? "," : "",
+                         taskSnap[i].name, taskSnap[i].priority, cpu, taskSnap[i].stackFreeMin);
+    }
+    if (used < maxLen) {
+        used += snprintf(out + used, maxLen - used, "]}");
+    }
+    return used < maxLen ? used : maxLen - 1;
+}
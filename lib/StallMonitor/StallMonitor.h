@@ -0,0 +1,83 @@
+#ifndef STALL_MONITOR_H
+#define STALL_MONITOR_H
+
+#include <Arduino.h>
+
+enum class StallSource : uint8_t {
+    RENDER,    // gap between loop() iterations
+    ASYNC_TCP, // a web handler running on the async_tcp task for too long
+    MONITOR,   // the monitor task itself woke late: something starved the CPU
+};
+
+static constexpr size_t STALL_SOURCE_COUNT = 3;
+
+struct StallStats {
+    uint32_t count;
+    uint32_t worstMs;
+    uint32_t lastGapMs;
+    uint32_t lastAtMs; // millis() when the last stall was flagged
+};
+
+// Without FreeRTOS run-time stats there is no per-task CPU figure at all.
+static constexpr uint8_t CPU_UNKNOWN = 0xFF;
+
+struct TaskSample {
+    char name[16];
+    uint8_t priority;
+    uint8_t cpuPercent;     // share of CPU since the previous sample, or CPU_UNKNOWN
+    uint16_t stackFreeMin;  // high-water mark, bytes never used
+    uint32_t taskNumber;
+    uint32_t runtime;
+};
+
+// Watchdog-style stall detector. The render loop and web handlers stamp
+// their progress; a small high-priority task checks the stamps every
+// CHECK_INTERVAL_MS, samples per-task CPU and stack use, and mirrors the
+// latest figures into RTC memory so they survive a watchdog reset.
+class StallMonitor {
+public:
+    static constexpr uint32_t CHECK_INTERVAL_MS = 100;
+    static constexpr uint32_t TASK_SAMPLE_INTERVAL_MS = 5000;
+    static constexpr size_t MAX_TASKS = 20;
+
+    void begin(uint32_t thresholdMs = 250);
+
+    // Called from every loop() iteration.
+    void beatRender();
+    // The render loop is deliberately blocked waiting for work (see
+    // PowerGovernor); render gaps are not stalls while this is set.
+    void setRenderIdle(bool idle);
+    // Bracket each web handler.
+    void enterCallback();
+    void exitCallback();
+
+    size_t writeJson(char *out, size_t maxLen);
+
+private:
+    uint32_t threshold = 250;
+    volatile uint32_t lastRenderMs = 0;
+    volatile uint32_t callbackStartMs = 0; // 0 = no handler running
+    volatile bool renderFlagged = false;
+    volatile bool renderIdle = false;
+    volatile bool callbackFlagged = false;
+    StallStats stats[STALL_SOURCE_COUNT] = {};
+
+    TaskSample tasks[MAX_TASKS] = {};
+    size_t taskCount = 0;
+
+    void note(StallSource source, uint32_t gapMs, bool newStall);
+    void check(uint32_t lateMs);
+    void sampleTasks();
+    static void reportPreviousBoot();
+    static void monitorTask(void *arg);
+};
+
+extern StallMonitor stallMonitor;
+
+// Brackets a web handler for the duration of a scope.
+struct StallCallbackScope {
+    StallCallbackScope() { stallMonitor.enterCallback(); }
+    ~StallCallbackScope() { stallMonitor.exitCallback(); }
+};
+
+#endif
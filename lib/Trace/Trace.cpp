@@ -0,0 +1,89 @@
+#include "Trace.h"
+
+TraceRecorder traceRecorder;
+
+#ifdef ARDUINO
+// Records come from both the render loop and the async_tcp task.
+static portMUX_TYPE traceMux = portMUX_INITIALIZER_UNLOCKED;
+#define TRACE_LOCK() portENTER_CRITICAL(&traceMux)
+#define TRACE_UNLOCK() portEXIT_CRITICAL(&traceMux)
+#else
+#define TRACE_LOCK()
+#define TRACE_UNLOCK()
+
+static TraceObserver observer = nullptr;
+
+void traceSetObserver(TraceObserver next) { observer = next; }
+#endif
+
+void TraceRecorder::record(TraceEvent event, uint8_t code, uint16_t arg, uint32_t value) {
+    const uint32_t now = micros();
+#ifndef ARDUINO
+    if (observer) {
+        const TraceRecord seen = {now, static_cast<uint8_t>(event), code, arg, value};
+        observer(seen);
+    }
+#endif
+    TRACE_LOCK();
+    if (!paused) {
+        TraceRecord &slot = ring[head];
+        slot.timeUs = now;
+        slot.event = static_cast<uint8_t>(event);
+        slot.code = code;
+        slot.arg = arg;
+        slot.value = value;
+        head = (head + 1) % TRACE_CAPACITY;
+        if (count < TRACE_CAPACITY) {
+            count++;
+        } else {
+            overwritten++;
+        }
+    }
+    TRACE_UNLOCK();
+}
+
+void TraceRecorder::setPaused(bool value) {
+    TRACE_LOCK();
+    paused = value;
+    TRACE_UNLOCK();
+}
+
+void TraceRecorder::clear() {
+    TRACE_LOCK();
+    head = 0;
+    count = 0;
+    overwritten = 0;
+    TRACE_UNLOCK();
+}
+
+size_t TraceRecorder::readSerialized(size_t offset, uint8_t *out, size_t maxLen) const {
+    TraceFileHeader header;
+    memcpy(header.magic, "CSLT", 4);
+    header.version = VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    header.count = count;
+    header.overwritten = overwritten;
+
+    const size_t total = serializedSize();
+    const size_t oldest = (head + TRACE_CAPACITY - count) % TRACE_CAPACITY;
+    size_t copied = 0;
+    while (offset < total && copied < maxLen) {
+        const uint8_t *src;
+        size_t available;
+        if (offset < sizeof(header)) {
+            src = reinterpret_cast<const uint8_t *>(&header) + offset;
+            available = sizeof(header) - offset;
+        } else {
+            const size_t recordOffset = offset - sizeof(header);
+            const size_t index = (oldest + recordOffset / sizeof(TraceRecord)) % TRACE_CAPACITY;
+            const size_t within = recordOffset % sizeof(TraceRecord);
+            src = reinterpret_cast<const uint8_t *>(&ring[index]) + within;
+            available = sizeof(TraceRecord) - within;
+        }
+        const size_t n = available < maxLen - copied ? available : maxLen - copied;
+        memcpy(out + copied, src, n);
+        copied += n;
+        offset += n;
+    }
+    return copied;
+}
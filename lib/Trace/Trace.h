@@ -0,0 +1,92 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+
+#ifndef TRACE_CAPACITY
+#define TRACE_CAPACITY 1024 // records, 12 bytes each
+#endif
+
+// Compact binary trace of commands, mode transitions and PWM writes, kept in
+// a RAM ring buffer and downloaded from /api/trace. tools/trace_replay feeds a
+// capture back through the native LEDController/StateHandler build.
+enum class TraceEvent : uint8_t {
+    SNAPSHOT = 1,   // code=mode, arg=unlocked, value=party mHz
+    SNAPSHOT_COLOR, // arg=red, value=green<<16|blue (requested, 11-bit)
+    COMMAND,        // code=TraceCommand, see WiFiManager handlers for args
+    MODE,           // code=new mode, arg=previous mode
+    PWM,            // code=LEDC channel, value=duty actually written
+    TICK,           // render tick that produced output, value=millis()
+};
+
+enum class TraceCommand : uint8_t {
+    RGB = 1,  // value=r<<16|g<<8|b as received (0-255); arg=1 when queued
+    MODE,     // arg=OperationMode
+    SCENE,    // arg=scene index
+    PARTY_HZ, // value=mHz after clamping; arg=1 when queued
+    UNLOCK,
+    RESET,
+    FRAME,    // raw channels (0-2047): arg=ch0, value=ch1<<16|ch2
+    SCHEDULE, // arg=ScheduleAction, value=scene index, mode, party mHz or fade seconds
+    FADE,     // fade step output (0-2047): arg=red, value=green<<16|blue
+    APPLY,    // the latest queued RGB and PARTY_HZ take effect; earlier ones were merged
+};
+
+struct TraceRecord {
+    uint32_t timeUs;
+    uint8_t event;
+    uint8_t code;
+    uint16_t arg;
+    uint32_t value;
+};
+
+// File layout served by /api/trace: header, then `count` records oldest first.
+struct TraceFileHeader {
+    char magic[4]; // "CSLT"
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t count;
+    uint32_t overwritten; // records lost to wrap-around before the first one
+};
+
+static_assert(sizeof(TraceRecord) == 12, "trace record layout is part of the file format");
+static_assert(sizeof(TraceFileHeader) == 16, "trace header layout is part of the file format");
+
+class TraceRecorder {
+public:
+    static constexpr uint16_t VERSION = 2;
+
+    void record(TraceEvent event, uint8_t code, uint16_t arg, uint32_t value);
+
+    // Freezes the buffer (e.g. while it is being downloaded).
+    void setPaused(bool value);
+    void clear();
+
+    size_t size() const { return count; }
+    uint32_t overwrittenCount() const { return overwritten; }
+
+    // Serialized trace bytes from `offset`; returns the number copied.
+    size_t serializedSize() const { return sizeof(TraceFileHeader) + count * sizeof(TraceRecord); }
+    size_t readSerialized(size_t offset, uint8_t *out, size_t maxLen) const;
+
+private:
+    TraceRecord ring[TRACE_CAPACITY];
+    size_t head = 0;  // next write position
+    size_t count = 0;
+    uint32_t overwritten = 0;
+    bool paused = false;
+};
+
+extern TraceRecorder traceRecorder;
+
+#ifndef ARDUINO
+// Host tools (the simulator) see every record as it is made, paused or not.
+typedef void (*TraceObserver)(const TraceRecord &record);
+void traceSetObserver(TraceObserver observer);
+#endif
+
+inline void traceEvent(TraceEvent event, uint8_t code = 0, uint16_t arg = 0, uint32_t value = 0) {
+    traceRecorder.record(event, code, arg, value);
+}
+
+#endif
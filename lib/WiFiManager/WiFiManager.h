@@ -1,18 +1,35 @@
 #include <WiFi.h>
 #include <ESPAsyncWebServer.h>
 #include <AsyncTCP.h>
+#ifdef WEB_ASSETS_FROM_SPIFFS
 #include <SPIFFS.h>
+#else
+#include "WebAssets.h"
+#endif
 #include "LEDController.h"
 #include <ESPmDNS.h>
 #include "State.h"
 #include "DebugLog.h"
+#include "FormParser.h"
+#include "OtaUpdater.h"
+#include "Scenes.h"
+#include "Scheduler.h"
+#include "Trace.h"
+#include "StallMonitor.h"
+#include "LampCommands.h"
+#include "MqttBridge.h"
+#include "PowerGovernor.h"
+#include "Admission.h"
 
 class WiFiManager
 {
 private:
     AsyncWebServer server;
-    LEDController &ledController;
+    LampLEDController &ledController;
     StateHandler *stateHandler = nullptr;
+    Scheduler *scheduler = nullptr;
+    LampCommands *commands = nullptr;
+    MqttBridge *mqtt = nullptr;
 
     // Station (home network) credentials and static IP config
     const char *staSsid = "USSS-Van-4";
@@ -29,8 +46,19 @@ private:
 
     bool apFallback = false;
     bool started = false;
-    float partyHz = 0.6f;
 
+    // Control bodies parsed without touching the heap (see captureFormBody).
+    static constexpr size_t FORM_POOL_SIZE = 6;
+    FormSlotPool<FORM_POOL_SIZE> formPool;
+
+    // Caps concurrent requests and per-client rates (see admit()).
+    AdmissionControl admission;
+
+    OtaUpdater ota;
+    const void *otaRequest = nullptr;
+    unsigned long restartAt = 0;
+
+#ifdef WEB_ASSETS_FROM_SPIFFS
     void handleRoot(AsyncWebServerRequest *request)
     {
         Serial.println("Serving index.html");
@@ -51,180 +79,649 @@ private:
         Serial.println("Serving iro_script.js");
         request->send(SPIFFS, "/iro_script.js", "text/javascript");
     }
+#else
+    // Serves a page straight from the gzip bundle linked into flash by
+    // tools/embed_assets.py; the ETag is the content hash of the source file.
+    void serveAsset(AsyncWebServerRequest *request, const WebAsset &asset)
+    {
+        if (request->hasHeader("If-None-Match") && strcmp(request->header("If-None-Match").c_str(), asset.etag) == 0)
+        {
+            reply(request, 304);
+            return;
+        }
+
+        AsyncWebServerResponse *response = request->beginResponse_P(200, asset.contentType, asset.data, asset.length);
+        response->addHeader("Content-Encoding", "gzip");
+        response->addHeader("ETag", asset.etag);
+        response->addHeader("Cache-Control", asset.immutable ? "max-age=31536000" : "no-cache");
+        reply(request, response);
+    }
+#endif
 
     void handleLockStatus(AsyncWebServerRequest *request)
     {
         Serial.println("Lock status requested");
         bool isUnlocked = ledController.isUnlocked();
         Serial.printf("Current lock status: %s\n", isUnlocked ? "unlocked" : "locked");
-        String response = isUnlocked ? "{\"unlocked\":true}" : "{\"unlocked\":false}";
-        request->send(200, "application/json", response);
+        const char *response = isUnlocked ? "{\"unlocked\":true}" : "{\"unlocked\":false}";
+        reply(request, 200, "application/json", response);
     }
 
     void handleUnlock(AsyncWebServerRequest *request)
     {
         Serial.println("Unlock requested");
-        ledController.unlock();
-        ledController.checkAndUpdatePowerLimit();
+        commands->unlock();
         Serial.println("Unlock complete");
-        request->send(200, "text/plain", "OK");
+        reply(request, 200, "text/plain", "OK");
     }
 
     void handleReset(AsyncWebServerRequest *request)
     {
         Serial.println("Reset requested");
-        ledController.resetToSafeMode();
-        ledController.checkAndUpdatePowerLimit();
+        commands->resetToSafeMode();
         Serial.println("Reset complete");
-        request->send(200, "text/plain", "OK");
+        reply(request, 200, "text/plain", "OK");
     }
 
-    void handleRGB(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+    // Stores a small raw control body in the form pool so the request handler
+    // can read it without AsyncWebServer building String params. Bodies sent as
+    // application/x-www-form-urlencoded never reach here; those fall back to
+    // request params in formValue().
+    void captureFormBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
     {
-        if (request->hasParam("r", true) && request->hasParam("g", true) && request->hasParam("b", true))
+        if (index != 0 || len != total)
         {
-            int r = request->getParam("r", true)->value().toInt();
-            int g = request->getParam("g", true)->value().toInt();
-            int b = request->getParam("b", true)->value().toInt();
-
-            // Debug print
-            Serial.printf("Received RGB request: r=%d, g=%d, b=%d\n", r, g, b);
+            return; // chunked or oversized bodies are rejected as missing params
+        }
+        FormFields *fields = formPool.claim(request, millis());
+        if (fields && !fields->parse(data, len))
+        {
+            formPool.release(request);
+        }
+    }
 
-            int mappedR = map(constrain(r, 0, 255), 0, 255, 0, 2047);
-            int mappedG = map(constrain(g, 0, 255), 0, 255, 0, 2047);
-            int mappedB = map(constrain(b, 0, 255), 0, 255, 0, 2047);
+    const char *paramValue(AsyncWebServerRequest *request, const char *key, bool post)
+    {
+        const size_t count = request->params();
+        for (size_t i = 0; i < count; i++)
+        {
+            AsyncWebParameter *param = request->getParam(i);
+            if (param->isPost() == post && strcmp(param->name().c_str(), key) == 0)
+            {
+                return param->value().c_str();
+            }
+        }
+        return nullptr;
+    }
 
-            Serial.printf("Mapped RGB values: r=%d, g=%d, b=%d\n", mappedR, mappedG, mappedB);
+    const char *formValue(AsyncWebServerRequest *request, const char *key)
+    {
+        if (FormFields *fields = formPool.find(request))
+        {
+            return fields->get(key);
+        }
+        return paramValue(request, key, true);
+    }
 
-            ledController.setPWMDirectly(mappedR, mappedG, mappedB);
-            request->send(200, "text/plain", "OK");
+    // First gate for every request except OTA. Rejections are answered at once
+    // with Retry-After so the client backs off and its connection is freed.
+    // Body callbacks pass reply=false; the request handler, which always comes
+    // last, sends the reply and is where an untracked rejection is counted.
+    bool admit(AsyncWebServerRequest *request, AdmissionPriority priority, bool reply = true)
+    {
+        bool firstSeen = false;
+        const AdmissionDecision decision = admission.check(
+            request, static_cast<uint32_t>(request->client()->remoteIP()), priority, millis(), ESP.getFreeHeap(), reply,
+            firstSeen);
+        if (firstSeen)
+        {
+            // Two pointers fit std::function's inline storage, so this does not allocate.
+            request->onDisconnect([this, request]()
+                                  { requestDone(request); });
         }
-        else
+        if (decision == AdmissionDecision::ADMIT)
+        {
+            return true;
+        }
+        if (reply)
         {
-            Serial.println("Invalid RGB parameters received");
-            request->send(400, "text/plain", "Bad Request");
+            rejectRequest(request, decision);
         }
+        return false;
+    }
+
+    void requestDone(AsyncWebServerRequest *request)
+    {
+        admission.finish(request);
+        formPool.release(request);
+    }
+
+    // Every API reply except /api/ota carries the CORS headers, so other pages
+    // may read and drive the lamp but get no say in a firmware upload.
+    void reply(AsyncWebServerRequest *request, AsyncWebServerResponse *response)
+    {
+        response->addHeader("Access-Control-Allow-Origin", "*");
+        response->addHeader("Access-Control-Allow-Methods", "GET, POST, PUT");
+        response->addHeader("Access-Control-Allow-Headers", "Content-Type");
+        request->send(response);
     }
 
-    String modeToString(OperationMode mode) const
+    void reply(AsyncWebServerRequest *request, int code, const char *contentType = "", const char *content = "")
     {
-        switch (mode)
+        reply(request, request->beginResponse(code, contentType, content));
+    }
+
+    void rejectRequest(AsyncWebServerRequest *request, AdmissionDecision decision)
+    {
+        const bool limited = decision == AdmissionDecision::RATE_LIMITED;
+        const char *body = limited ? "{\"error\":\"rate limited\"}"
+                           : decision == AdmissionDecision::LOW_HEAP ? "{\"error\":\"low memory\"}"
+                                                                     : "{\"error\":\"busy\"}";
+        AsyncWebServerResponse *response = request->beginResponse(limited ? 429 : 503, "application/json", body);
+        char retryAfter[8];
+        snprintf(retryAfter, sizeof(retryAfter), "%lu", static_cast<unsigned long>(AdmissionControl::retryAfterSeconds(decision)));
+        response->addHeader("Retry-After", retryAfter);
+        reply(request, response);
+    }
+
+    void onRoute(const char *uri, WebRequestMethodComposite method, void (WiFiManager::*handler)(AsyncWebServerRequest *),
+                 AdmissionPriority priority = AdmissionPriority::NORMAL)
+    {
+        server.on(uri, method, [this, handler, priority](AsyncWebServerRequest *request)
+                  {
+            StallCallbackScope scope;
+            if (admit(request, priority)) {
+                (this->*handler)(request);
+            } });
+    }
+
+    void onControl(const char *uri, void (WiFiManager::*handler)(AsyncWebServerRequest *),
+                   AdmissionPriority priority = AdmissionPriority::NORMAL)
+    {
+        server.on(
+            uri, HTTP_POST,
+            [this, handler, priority](AsyncWebServerRequest *request)
+            {
+                StallCallbackScope scope;
+                if (admit(request, priority))
+                {
+                    powerGovernor.wake();
+                    if (commands)
+                    {
+                        (this->*handler)(request);
+                    }
+                    else
+                    {
+                        reply(request, 503, "application/json", "{\"error\":\"not ready\"}");
+                    }
+                }
+                formPool.release(request);
+            },
+            nullptr,
+            [this, priority](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+            {
+                if (admit(request, priority, false))
+                {
+                    captureFormBody(request, data, len, index, total);
+                }
+            });
+    }
+
+    void handleRGB(AsyncWebServerRequest *request)
+    {
+        int r, g, b;
+        if (!formParseInt(formValue(request, "r"), r) ||
+            !formParseInt(formValue(request, "g"), g) ||
+            !formParseInt(formValue(request, "b"), b))
         {
-        case OperationMode::PARTY:
-            return "party";
-        case OperationMode::WIFI:
-            return "wifi";
-        case OperationMode::OFF:
-            return "off";
-        default:
-            return "unknown";
+            reply(request, 400, "text/plain", "Missing parameters");
+            return;
         }
+
+        // Debug output
+        Serial.printf("[WiFi] Received RGB: %d,%d,%d\n", r, g, b);
+
+        commands->queueColor(r, g, b); // merged with any color the render loop has not applied yet
+        reply(request, 200, "text/plain", "OK");
     }
 
-    bool stringToMode(const String &value, OperationMode &modeOut) const
+    void handleMode(AsyncWebServerRequest *request)
     {
-        String lower = value;
-        lower.toLowerCase();
-        if (lower == "party")
+        const char *value = formValue(request, "mode");
+        if (!value)
         {
-            modeOut = OperationMode::PARTY;
-            return true;
+            reply(request, 400, "application/json", "{\"error\":\"mode missing\"}");
+            return;
         }
-        if (lower == "wifi" || lower == "remote")
+
+        OperationMode requestedMode;
+        if (!parseOperationMode(value, requestedMode))
         {
-            modeOut = OperationMode::WIFI;
-            return true;
+            reply(request, 400, "application/json", "{\"error\":\"unknown mode\"}");
+            return;
         }
-        if (lower == "off" || lower == "sleep")
+
+        commands->setMode(requestedMode);
+        reply(request, 200, "application/json", "{\"ok\":true}");
+    }
+
+    void handleScene(AsyncWebServerRequest *request)
+    {
+        const char *scene = formValue(request, "scene");
+        if (!scene)
         {
-            modeOut = OperationMode::OFF;
-            return true;
+            reply(request, 400, "application/json", "{\"error\":\"scene missing\"}");
+            return;
         }
-        return false;
+        commands->applyScene(scene);
+        reply(request, 200, "application/json", "{\"ok\":true}");
     }
 
-    void sendStatus(AsyncWebServerRequest *request)
+    void handleParty(AsyncWebServerRequest *request)
     {
-        String mode = "unknown";
-        if (stateHandler)
+        float hz;
+        if (!formParseFloat(formValue(request, "hz"), hz))
         {
-            mode = modeToString(stateHandler->getCurrentMode());
+            reply(request, 400, "application/json", "{\"error\":\"hz missing\"}");
+            return;
         }
+        commands->queuePartyHz(hz);
+        reply(request, 200, "application/json", "{\"ok\":true}");
+    }
 
-        IPAddress ip = apFallback ? WiFi.softAPIP() : WiFi.localIP();
-        String ipStr = ip.toString();
+    // Streams the request body into the OTA updater as it arrives; nothing
+    // larger than one network segment is ever held in RAM.
+    void handleOtaBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+    {
+        (void)total;
+        if (index == 0)
+        {
+            if (otaRequest != nullptr)
+            {
+                return; // another upload owns the updater
+            }
+            if (!ota.begin(paramValue(request, "sha256", false), paramValue(request, "sig", false),
+                           paramValue(request, "encoding", false)))
+            {
+                return;
+            }
+            otaRequest = request;
+            request->onDisconnect([this, request]()
+                                  {
+                if (otaRequest == request) {
+                    ota.abort("connection lost");
+                    otaRequest = nullptr;
+                } });
+        }
+
+        if (otaRequest == request)
+        {
+            ota.write(data, len);
+        }
+    }
 
-        String payload = "{";
-        payload += "\"mode\":\"" + mode + "\",";
-        payload += "\"unlocked\":" + String(ledController.isUnlocked() ? "true" : "false") + ",";
-        payload += "\"ip\":\"" + ipStr + "\",";
-        payload += "\"apFallback\":" + String(apFallback ? "true" : "false") + ",";
-        payload += "\"partyHz\":" + String(partyHz, 2);
-        payload += "}";
+    void handleOta(AsyncWebServerRequest *request)
+    {
+        char payload[96];
+        if (otaRequest != request)
+        {
+            snprintf(payload, sizeof(payload), "{\"error\":\"%s\"}",
+                     otaRequest ? "update already in progress" : ota.lastError());
+            const int code = otaRequest ? 409 : ota.wasDenied() ? 403 : ota.wasMalformed() ? 400 : 409;
+            request->send(code, "application/json", payload);
+            return;
+        }
+        otaRequest = nullptr;
+
+        if (!ota.finish())
+        {
+            snprintf(payload, sizeof(payload), "{\"error\":\"%s\"}", ota.lastError());
+            request->send(500, "application/json", payload);
+            return;
+        }
 
+        snprintf(payload, sizeof(payload), "{\"ok\":true,\"bytes\":%u}", static_cast<unsigned>(ota.imageBytes()));
         request->send(200, "application/json", payload);
+        restartAt = millis() + 1000; // let the response flush before rebooting
     }
 
-    void applyScene(const String &scene)
+    // POST fields: action=scene|mode|party|fade, value (scene/mode name or Hz),
+    // r,g,b + fade (seconds) for fades, and one of at (epoch), in (seconds from
+    // now) or daily (HH:MM local). every (seconds) makes an at/in entry repeat.
+    void handleScheduleAdd(AsyncWebServerRequest *request)
     {
-        String key = scene;
-        key.toLowerCase();
+        if (!scheduler || !stateHandler)
+        {
+            reply(request, 503, "application/json", "{\"error\":\"scheduler unavailable\"}");
+            return;
+        }
+        if (!Scheduler::clockValid())
+        {
+            reply(request, 409, "application/json", "{\"error\":\"clock not set\"}");
+            return;
+        }
 
-        int r = 0, g = 0, b = 0;
-        if (key == "sunset")
+        ScheduleEntry entry = {};
+        const char *action = formValue(request, "action");
+        const char *value = formValue(request, "value");
+        bool valid = action != nullptr;
+        if (valid && strcasecmp(action, "scene") == 0)
         {
-            r = 1900;
-            g = 750;
-            b = 180;
+            const int scene = findScene(value);
+            entry.action = ScheduleAction::SCENE;
+            entry.scene = static_cast<uint8_t>(scene);
+            valid = scene >= 0;
         }
-        else if (key == "ocean")
+        else if (valid && strcasecmp(action, "mode") == 0)
         {
-            r = 250;
-            g = 1100;
-            b = 1900;
+            entry.action = ScheduleAction::MODE;
+            valid = value && parseOperationMode(value, entry.mode);
         }
-        else if (key == "forest")
+        else if (valid && strcasecmp(action, "party") == 0)
         {
-            r = 250;
-            g = 1600;
-            b = 450;
+            entry.action = ScheduleAction::PARTY;
+            valid = formParseFloat(value, entry.partyHz);
+            entry.partyHz = constrain(entry.partyHz, 0.05f, 5.0f);
         }
-        else if (key == "focus")
+        else if (valid && strcasecmp(action, "fade") == 0)
         {
-            r = 1450;
-            g = 1500;
-            b = 1400;
+            int r, g, b, seconds;
+            entry.action = ScheduleAction::FADE;
+            valid = formParseInt(formValue(request, "r"), r) &&
+                    formParseInt(formValue(request, "g"), g) &&
+                    formParseInt(formValue(request, "b"), b) &&
+                    formParseInt(formValue(request, "fade"), seconds) && seconds >= 0;
+            if (valid)
+            {
+                entry.red = map(constrain(r, 0, 255), 0, 255, 0, 2047);
+                entry.green = map(constrain(g, 0, 255), 0, 255, 0, 2047);
+                entry.blue = map(constrain(b, 0, 255), 0, 255, 0, 2047);
+                entry.fadeSeconds = seconds;
+            }
         }
-        else if (key == "calm")
+        else
         {
-            r = 900;
-            g = 1050;
-            b = 1200;
+            valid = false;
         }
-        else if (key == "off")
+
+        if (!valid)
         {
-            r = g = b = 0;
+            reply(request, 400, "application/json", "{\"error\":\"bad action\"}");
+            return;
+        }
+
+        int at, in, every = 0;
+        const char *daily = formValue(request, "daily");
+        unsigned hour, minute;
+        if (daily && sscanf(daily, "%u:%u", &hour, &minute) == 2 && hour < 24 && minute < 60)
+        {
+            entry.nextFire = scheduler->nextDailyAt(hour, minute);
+            entry.period = 86400UL;
+        }
+        else if (formParseInt(formValue(request, "at"), at) && at > 0)
+        {
+            entry.nextFire = at;
+        }
+        else if (formParseInt(formValue(request, "in"), in) && in >= 0)
+        {
+            entry.nextFire = Scheduler::now() + in;
         }
         else
         {
-            // Unknown scene
+            reply(request, 400, "application/json", "{\"error\":\"time missing\"}");
+            return;
+        }
+        if (!daily && formParseInt(formValue(request, "every"), every) && every > 0)
+        {
+            if (static_cast<uint32_t>(every) < Scheduler::MIN_PERIOD_S)
+            {
+                reply(request, 400, "application/json", "{\"error\":\"every must be at least 60 s\"}");
+                return;
+            }
+            entry.period = every;
+        }
+
+        const uint8_t id = scheduler->add(entry);
+        if (id == 0)
+        {
+            reply(request, 507, "application/json", "{\"error\":\"schedule full\"}");
             return;
         }
+        char payload[48];
+        snprintf(payload, sizeof(payload), "{\"ok\":true,\"id\":%u}", id);
+        reply(request, 200, "application/json", payload);
+    }
 
+    void handleScheduleDelete(AsyncWebServerRequest *request)
+    {
+        int id;
+        if (!scheduler || !formParseInt(formValue(request, "id"), id))
+        {
+            reply(request, 400, "application/json", "{\"error\":\"id missing\"}");
+            return;
+        }
+        if (id == 0)
+        {
+            scheduler->clear();
+        }
+        else if (!scheduler->remove(static_cast<uint8_t>(id)))
+        {
+            reply(request, 404, "application/json", "{\"error\":\"unknown id\"}");
+            return;
+        }
+        reply(request, 200, "application/json", "{\"ok\":true}");
+    }
+
+    void sendSchedules(AsyncWebServerRequest *request)
+    {
+        // Heap order is not sorted order, but every entry appears exactly once.
+        char payload[64 + Scheduler::MAX_ENTRIES * 96];
+        size_t used = snprintf(payload, sizeof(payload), "{\"now\":%lu,\"utcOffset\":%d,\"entries\":[",
+                               static_cast<unsigned long>(Scheduler::now()),
+                               scheduler ? scheduler->utcOffsetMinutes() : 0);
+        ScheduleEntry list[Scheduler::MAX_ENTRIES];
+        const size_t count = scheduler ? scheduler->copyEntries(list, Scheduler::MAX_ENTRIES) : 0;
+        for (size_t i = 0; i < count && used < sizeof(payload); i++)
+        {
+            const ScheduleEntry *e = &list[i];
+            used += snprintf(payload + used, sizeof(payload) - used,
+                             "%s{\"id\":%u,\"action\":%u,\"next\":%lu,\"every\":%lu}",
+                             i ? "," : "", e->id, static_cast<unsigned>(e->action),
+                             static_cast<unsigned long>(e->nextFire), static_cast<unsigned long>(e->period));
+        }
+        if (used < sizeof(payload))
+        {
+            snprintf(payload + used, sizeof(payload) - used, "]}");
+        }
+        reply(request, 200, "application/json", payload);
+    }
+
+    // epoch (UTC seconds) and optional offset (minutes east of UTC).
+    void handleTime(AsyncWebServerRequest *request)
+    {
+        int epoch, offset = scheduler ? scheduler->utcOffsetMinutes() : 0;
+        if (!scheduler || !formParseInt(formValue(request, "epoch"), epoch) || epoch <= 0)
+        {
+            reply(request, 400, "application/json", "{\"error\":\"epoch missing\"}");
+            return;
+        }
+        formParseInt(formValue(request, "offset"), offset);
+        scheduler->setClock(static_cast<uint32_t>(epoch), static_cast<int16_t>(constrain(offset, -720, 840)));
+        reply(request, 200, "application/json", "{\"ok\":true}");
+    }
+
+    // Downloads the trace ring buffer. Recording is paused until the client
+    // disconnects so the records being streamed cannot be overwritten.
+    void sendTrace(AsyncWebServerRequest *request)
+    {
         if (stateHandler)
         {
-            stateHandler->setMode(OperationMode::WIFI);
+            stateHandler->traceSnapshot();
         }
-        ledController.setPWMDirectly(r, g, b);
+        traceRecorder.setPaused(true);
+        AsyncWebServerResponse *response = request->beginResponse(
+            "application/octet-stream", traceRecorder.serializedSize(),
+            [](uint8_t *buffer, size_t maxLen, size_t index) -> size_t
+            { return traceRecorder.readSerialized(index, buffer, maxLen); });
+        response->addHeader("Content-Disposition", "attachment; filename=\"lamp.trace\"");
+        request->onDisconnect([this, request]()
+                              {
+            traceRecorder.setPaused(false);
+            requestDone(request); });
+        reply(request, response);
     }
 
-    void updatePartyHz(float hz)
+    void handleTraceClear(AsyncWebServerRequest *request)
     {
-        partyHz = hz;
+        traceRecorder.clear();
         if (stateHandler)
         {
-            stateHandler->setPartyHz(hz);
+            stateHandler->traceSnapshot();
+        }
+        reply(request, 200, "application/json", "{\"ok\":true}");
+    }
+
+    void sendStallReport(AsyncWebServerRequest *request)
+    {
+        static char payload[2048]; // handlers all run on the async_tcp task
+        stallMonitor.writeJson(payload, sizeof(payload));
+        reply(request, 200, "application/json", payload);
+    }
+
+    void sendAdmissionReport(AsyncWebServerRequest *request)
+    {
+        const AdmissionStats &stats = admission.stats();
+        char payload[224];
+        snprintf(payload, sizeof(payload),
+                 "{\"inFlight\":%u,\"peakInFlight\":%u,\"admitted\":%lu,\"shed\":{\"rateLimited\":%lu,\"busy\":%lu,"
+                 "\"lowHeap\":%lu},\"merged\":%lu,\"heapFloor\":%lu}",
+                 static_cast<unsigned>(admission.inFlight()), stats.peakInFlight,
+                 static_cast<unsigned long>(stats.admitted), static_cast<unsigned long>(stats.rateLimited),
+                 static_cast<unsigned long>(stats.busy), static_cast<unsigned long>(stats.lowHeap),
+                 static_cast<unsigned long>(commands ? commands->mergedCount() : 0),
+                 static_cast<unsigned long>(AdmissionControl::HEAP_FLOOR));
+        reply(request, 200, "application/json", payload);
+    }
+
+    void sendHeapReport(AsyncWebServerRequest *request)
+    {
+        HeapSnapshot heap = captureHeap();
+        char payload[224];
+        snprintf(payload, sizeof(payload),
+                 "{\"free\":%u,\"largestBlock\":%u,\"minFree\":%u,\"allocBlocks\":%u,"
+                 "\"freeBlocks\":%u,\"fragPct\":%u,\"formPoolInUse\":%u,\"formPoolDropped\":%u}",
+                 heap.freeBytes, heap.largestBlock, heap.minimumFree, heap.allocatedBlocks,
+                 heap.freeBlocks, heap.fragmentationPercent(),
+                 static_cast<unsigned>(formPool.inUse()), formPool.droppedCount());
+        reply(request, 200, "application/json", payload);
+    }
+
+    void sendMqttStatus(AsyncWebServerRequest *request)
+    {
+        char payload[256];
+        if (!mqtt)
+        {
+            reply(request, 503, "application/json", "{\"error\":\"mqtt unavailable\"}");
+            return;
+        }
+        mqtt->writeStatusJson(payload, sizeof(payload));
+        reply(request, 200, "application/json", payload);
+    }
+
+    // host=broker.lan&port=1883&user=..&pass=..; an empty host disables MQTT.
+    void handleMqttConfig(AsyncWebServerRequest *request)
+    {
+        const char *host = formValue(request, "host");
+        int port = 1883;
+        const char *portText = formValue(request, "port");
+        if (!mqtt || host == nullptr || (portText && (!formParseInt(portText, port) || port <= 0 || port > 65535)))
+        {
+            reply(request, 400, "application/json", "{\"error\":\"host or port invalid\"}");
+            return;
         }
+        mqtt->configure(host, static_cast<uint16_t>(port), formValue(request, "user"), formValue(request, "pass"));
+        reply(request, 200, "application/json", "{\"ok\":true}");
+    }
+
+    void sendPwmTiming(AsyncWebServerRequest *request)
+    {
+        replyPwmTiming(request, ledController.getTiming());
+    }
+
+    void replyPwmTiming(AsyncWebServerRequest *request, const PwmTiming &timing)
+    {
+        char payload[96];
+        snprintf(payload, sizeof(payload), "{\"freq\":%lu,\"bits\":%u,\"phase\":\"%s\"}",
+                 static_cast<unsigned long>(timing.frequency), timing.resolution, pwmPhaseName(timing.phase));
+        reply(request, 200, "application/json", payload);
+    }
+
+    // freq=4000&bits=14&phase=staggered; omitted fields keep their value. The
+    // render loop applies it on its next tick; the reply echoes the new timing.
+    void handlePwmTiming(AsyncWebServerRequest *request)
+    {
+        PwmTiming timing = ledController.getTiming();
+        int freq = static_cast<int>(timing.frequency);
+        int bits = timing.resolution;
+        const char *freqText = formValue(request, "freq");
+        const char *bitsText = formValue(request, "bits");
+        const char *phaseText = formValue(request, "phase");
+        if ((freqText && (!formParseInt(freqText, freq) || freq <= 0)) ||
+            (bitsText && (!formParseInt(bitsText, bits) || bits <= 0 || bits > 255)) ||
+            (phaseText && !pwmParsePhase(phaseText, timing.phase)))
+        {
+            reply(request, 400, "application/json", "{\"error\":\"invalid freq, bits or phase\"}");
+            return;
+        }
+        timing.frequency = static_cast<uint32_t>(freq);
+        timing.resolution = static_cast<uint8_t>(bits);
+        if (!commands->queueTiming(timing))
+        {
+            reply(request, 400, "application/json", "{\"error\":\"freq x 2^bits exceeds the 80 MHz LEDC clock or divider range\"}");
+            return;
+        }
+        replyPwmTiming(request, timing);
+    }
+
+    void sendPowerReport(AsyncWebServerRequest *request)
+    {
+        char payload[320];
+        powerGovernor.writeJson(payload, sizeof(payload));
+        reply(request, 200, "application/json", payload);
+    }
+
+    void handlePowerPolicy(AsyncWebServerRequest *request)
+    {
+        PowerPolicy policy;
+        if (!parsePowerPolicy(formValue(request, "policy"), policy))
+        {
+            reply(request, 400, "application/json", "{\"error\":\"policy must be performance, balanced or saver\"}");
+            return;
+        }
+        powerGovernor.setPolicy(policy);
+        reply(request, 200, "application/json", "{\"ok\":true}");
+    }
+
+    void sendStatus(AsyncWebServerRequest *request)
+    {
+        const char *mode = stateHandler ? operationModeName(stateHandler->getCurrentMode()) : "unknown";
+        IPAddress ip = apFallback ? WiFi.softAPIP() : WiFi.localIP();
+
+        char payload[192];
+        snprintf(payload, sizeof(payload),
+                 "{\"mode\":\"%s\",\"unlocked\":%s,\"ip\":\"%u.%u.%u.%u\",\"apFallback\":%s,\"partyHz\":%.2f,\"assets\":\"%s\"}",
+                 mode,
+                 ledController.isUnlocked() ? "true" : "false",
+                 ip[0], ip[1], ip[2], ip[3],
+                 apFallback ? "true" : "false",
+                 stateHandler ? stateHandler->getPartyHz() : 0.0f,
+#ifdef WEB_ASSETS_FROM_SPIFFS
+                 "spiffs");
+#else
+                 WEB_ASSETS_HASH);
+#endif
+
+        reply(request, 200, "application/json", payload);
     }
 
     bool connectToStation()
@@ -232,7 +729,7 @@ private:
         logStatus("WIFI", "Connecting to SSID=%s", staSsid);
         Serial.printf("Connecting to Wi-Fi SSID: %s\n", staSsid);
         WiFi.mode(WIFI_STA);
-        WiFi.setSleep(false);
+        WiFi.setSleep(false); // PowerGovernor enables modem sleep once the lamp idles
         WiFi.setTxPower(WIFI_POWER_19_5dBm);
 
         if (!WiFi.config(localIp, gateway, subnet, primaryDns, secondaryDns))
@@ -276,33 +773,47 @@ private:
     }
 
 public:
-    WiFiManager(LEDController &controller) : server(80), ledController(controller) {}
+    WiFiManager(LampLEDController &controller) : server(80), ledController(controller) {}
 
     void attachStateHandler(StateHandler *handler)
     {
         stateHandler = handler;
-        if (stateHandler)
-        {
-            partyHz = stateHandler->getPartyHz();
-        }
+    }
+
+    void attachCommands(LampCommands *lampCommands)
+    {
+        commands = lampCommands;
+    }
+
+    void attachMqtt(MqttBridge *bridge)
+    {
+        mqtt = bridge;
+    }
+
+    void attachScheduler(Scheduler *sched)
+    {
+        scheduler = sched;
     }
 
     void logStatusSnapshot(OperationMode mode)
     {
-        String modeStr = modeToString(mode);
         const bool connected = WiFi.status() == WL_CONNECTED;
         IPAddress ip = apFallback ? WiFi.softAPIP() : WiFi.localIP();
         const int rssi = connected ? WiFi.RSSI() : 0;
+        const HeapSnapshot heap = captureHeap();
 
         logStatus("SNAP",
-                  "mode=%s wifiMode=%s connected=%s ip=%s apFallback=%s rssi=%d heap=%u",
-                  modeStr.c_str(),
+                  "mode=%s wifiMode=%s connected=%s ip=%u.%u.%u.%u apFallback=%s rssi=%d heap=%u largest=%u allocs=%u frag=%u%%",
+                  operationModeName(mode),
                   WiFi.getMode() == WIFI_AP ? "AP" : "STA",
                   connected ? "yes" : "no",
-                  ip.toString().c_str(),
+                  ip[0], ip[1], ip[2], ip[3],
                   apFallback ? "yes" : "no",
                   rssi,
-                  ESP.getFreeHeap());
+                  heap.freeBytes,
+                  heap.largestBlock,
+                  heap.allocatedBlocks,
+                  heap.fragmentationPercent());
     }
 
     void begin()
@@ -312,12 +823,14 @@ public:
             return;
         }
 
+#ifdef WEB_ASSETS_FROM_SPIFFS
         if (!SPIFFS.begin(true))
         {
             Serial.println("SPIFFS Mount Failed");
             logStatus("BOOT", "SPIFFS mount failed");
             return;
         }
+#endif
 
         // 1. Register WiFi event handler FIRST
         WiFi.onEvent([](WiFiEvent_t event, WiFiEventInfo_t info)
@@ -350,103 +863,78 @@ public:
             logStatus("WIFI", "mDNS started at colorshadow.local");
         }
 
-        
-        DefaultHeaders::Instance().addHeader("Access-Control-Allow-Origin", "*");
-        DefaultHeaders::Instance().addHeader("Access-Control-Allow-Methods", "GET, POST, PUT");
-        DefaultHeaders::Instance().addHeader("Access-Control-Allow-Headers", "Content-Type");
-
-        server.on("/", HTTP_GET, std::bind(&WiFiManager::handleRoot, this, std::placeholders::_1));
-        server.on("/iro.min.js", HTTP_GET, std::bind(&WiFiManager::handleIroMin, this, std::placeholders::_1));
-        server.on("/iro_script.js", HTTP_GET, std::bind(&WiFiManager::handleIroScript, this, std::placeholders::_1));
-        server.on("/lockStatus", HTTP_GET, std::bind(&WiFiManager::handleLockStatus, this, std::placeholders::_1));
-        server.on("/unlock", HTTP_POST, std::bind(&WiFiManager::handleUnlock, this, std::placeholders::_1));
-        server.on("/reset", HTTP_POST, std::bind(&WiFiManager::handleReset, this, std::placeholders::_1));
 
-        // In WiFiManager.h constructor
-        server.on("/postRGB", HTTP_POST, [this](AsyncWebServerRequest *request)
-                  {
-            // Check for all 3 parameters first
-            if(!request->hasParam("r", true) || !request->hasParam("g", true) || !request->hasParam("b", true)) {
-                request->send(400, "text/plain", "Missing parameters");
-                return;
+        // Each route allocates its functor once, here: `this` plus a member
+        // function pointer is 12 bytes on the C3, over std::function's 8-byte
+        // inline buffer. Requests themselves do not allocate for routing.
+        // onRoute/onControl also time each handler for the stall monitor.
+#ifdef WEB_ASSETS_FROM_SPIFFS
+        onRoute("/", HTTP_GET, &WiFiManager::handleRoot);
+        onRoute("/iro.min.js", HTTP_GET, &WiFiManager::handleIroMin);
+        onRoute("/iro_script.js", HTTP_GET, &WiFiManager::handleIroScript);
+#else
+        for (size_t i = 0; i < WEB_ASSET_COUNT; i++)
+        {
+            const WebAsset *asset = &WEB_ASSETS[i];
+            server.on(asset->path, HTTP_GET, [this, asset](AsyncWebServerRequest *request)
+                      {
+                if (admit(request, AdmissionPriority::NORMAL)) {
+                    serveAsset(request, *asset);
+                } });
+            if (strcmp(asset->path, "/index.html") == 0)
+            {
+                server.on("/", HTTP_GET, [this, asset](AsyncWebServerRequest *request)
+                          {
+                    if (admit(request, AdmissionPriority::NORMAL)) {
+                        serveAsset(request, *asset);
+                    } });
             }
+        }
+        logStatus("BOOT", "Serving %u embedded assets, bundle %s", static_cast<unsigned>(WEB_ASSET_COUNT), WEB_ASSETS_HASH);
+#endif
+        onRoute("/lockStatus", HTTP_GET, &WiFiManager::handleLockStatus);
+        onControl("/unlock", &WiFiManager::handleUnlock);
+        onControl("/reset", &WiFiManager::handleReset);
 
-            // Get and constrain values
-            int r = request->getParam("r", true)->value().toInt();
-            int g = request->getParam("g", true)->value().toInt();
-            int b = request->getParam("b", true)->value().toInt();
-            
-            r = constrain(r, 0, 255);
-            g = constrain(g, 0, 255);
-            b = constrain(b, 0, 255);
-
-            // Convert to 11-bit PWM range (0-2047)
-            int pwm_r = map(r, 0, 255, 0, 2047);
-            int pwm_g = map(g, 0, 255, 0, 2047);
-            int pwm_b = map(b, 0, 255, 0, 2047);
-
-            // Debug output
-            Serial.printf("[WiFi] Received RGB: %d,%d,%d -> PWM: %d,%d,%d\n", 
-                        r, g, b, pwm_r, pwm_g, pwm_b);
-
-            // Set LEDs - account for physical pin swap
-            ledController.setPWMDirectly(pwm_r, pwm_g, pwm_b);
-
-            // Force remote mode so pots do not override
-            if (stateHandler) {
-                stateHandler->setMode(OperationMode::WIFI);
-            }
-    
-        request->send(200, "text/plain", "OK"); });
+        onControl("/postRGB", &WiFiManager::handleRGB);
 
         server.on("/favicon.ico", HTTP_GET, [](AsyncWebServerRequest *request)
                   { request->send(404); });
 
-        server.on("/api/status", HTTP_GET, std::bind(&WiFiManager::sendStatus, this, std::placeholders::_1));
-
-        server.on("/api/mode", HTTP_POST, [this](AsyncWebServerRequest *request)
-                  {
-            if (!stateHandler || !request->hasParam("mode", true)) {
-                request->send(400, "application/json", "{\"error\":\"mode missing\"}");
-                return;
-            }
-
-            OperationMode requestedMode;
-            if (!stringToMode(request->getParam("mode", true)->value(), requestedMode)) {
-                request->send(400, "application/json", "{\"error\":\"unknown mode\"}");
-                return;
-            }
-
-            stateHandler->setMode(requestedMode);
-
-            if (requestedMode == OperationMode::OFF) {
-                ledController.setPWMDirectly(0, 0, 0);
-            }
-
-            request->send(200, "application/json", "{\"ok\":true}"); });
-
-        server.on("/api/scene", HTTP_POST, [this](AsyncWebServerRequest *request)
-                  {
-            if (!request->hasParam("scene", true)) {
-                request->send(400, "application/json", "{\"error\":\"scene missing\"}");
-                return;
-            }
-            applyScene(request->getParam("scene", true)->value());
-            request->send(200, "application/json", "{\"ok\":true}"); });
-
-        server.on("/api/party", HTTP_POST, [this](AsyncWebServerRequest *request)
-                  {
-            if (!request->hasParam("hz", true)) {
-                request->send(400, "application/json", "{\"error\":\"hz missing\"}");
-                return;
-            }
-            float hz = request->getParam("hz", true)->value().toFloat();
-            hz = constrain(hz, 0.05f, 5.0f);
-            updatePartyHz(hz);
-            if (stateHandler) {
-                stateHandler->setMode(OperationMode::PARTY);
-            }
-            request->send(200, "application/json", "{\"ok\":true}"); });
+        // Status, the admission report and mode changes may take the reserved
+        // slot, so a flood can still be watched and stopped.
+        onRoute("/api/status", HTTP_GET, &WiFiManager::sendStatus, AdmissionPriority::RESERVED);
+        onRoute("/api/admission", HTTP_GET, &WiFiManager::sendAdmissionReport, AdmissionPriority::RESERVED);
+        onRoute("/api/heap", HTTP_GET, &WiFiManager::sendHeapReport);
+        onRoute("/api/stalls", HTTP_GET, &WiFiManager::sendStallReport);
+
+        onControl("/api/mode", &WiFiManager::handleMode, AdmissionPriority::RESERVED);
+        onControl("/api/scene", &WiFiManager::handleScene);
+        onControl("/api/party", &WiFiManager::handleParty);
+        // Longer path first: "/api/schedule" would also match its sub-paths.
+        onControl("/api/schedule/delete", &WiFiManager::handleScheduleDelete);
+        onControl("/api/schedule", &WiFiManager::handleScheduleAdd);
+        onControl("/api/time", &WiFiManager::handleTime);
+        onRoute("/api/trace", HTTP_GET, &WiFiManager::sendTrace);
+        onRoute("/api/trace/clear", HTTP_POST, &WiFiManager::handleTraceClear);
+        onRoute("/api/schedule", HTTP_GET, &WiFiManager::sendSchedules);
+        onControl("/api/mqtt", &WiFiManager::handleMqttConfig);
+        onRoute("/api/mqtt", HTTP_GET, &WiFiManager::sendMqttStatus);
+        onControl("/api/power", &WiFiManager::handlePowerPolicy);
+        onRoute("/api/power", HTTP_GET, &WiFiManager::sendPowerReport);
+        onControl("/api/pwm", &WiFiManager::handlePwmTiming);
+        onRoute("/api/pwm", HTTP_GET, &WiFiManager::sendPwmTiming);
+
+        server.on(
+            "/api/ota", HTTP_POST,
+            [this](AsyncWebServerRequest *request) { handleOta(request); },
+            nullptr,
+            [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+            {
+                StallCallbackScope scope; // flash erases run on the async_tcp task
+                powerGovernor.wake();         // keep the clock up while the image streams in
+                handleOtaBody(request, data, len, index, total);
+            });
 
         try
         {
@@ -454,6 +942,7 @@ public:
             Serial.println("Async HTTP server started successfully");
             logStatus("WIFI", "HTTP server started");
             started = true;
+            OtaUpdater::confirmBoot();
         }
         catch (...)
         {
@@ -467,6 +956,11 @@ public:
     void update(OperationMode mode)
     {
         (void)mode;
+        if (restartAt != 0 && static_cast<long>(millis() - restartAt) >= 0)
+        {
+            logStatus("OTA", "Restarting into new firmware");
+            ESP.restart();
+        }
     }
 
     void stop()
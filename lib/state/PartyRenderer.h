@@ -0,0 +1,75 @@
+#ifndef PARTY_RENDERER_H
+#define PARTY_RENDERER_H
+
+#include <Arduino.h>
+#include <math.h>
+
+// Hue-cycling party effect. Kept apart from the render loop so host tools
+// (trace replay) step exactly the same math as the firmware.
+class PartyRenderer {
+private:
+    float hue = 0.0f; // degrees
+    unsigned long lastMillis = 0;
+
+    float advanceSeconds(unsigned long nowMillis) {
+        if (lastMillis == 0) {
+            lastMillis = nowMillis;
+            return 0.0f;
+        }
+        float dt = (nowMillis - lastMillis) / 1000.0f;
+        lastMillis = nowMillis;
+        return dt;
+    }
+
+public:
+    static void hsvToRgb11(float hDeg, float s, float v, int &rOut, int &gOut, int &bOut) {
+        float h = fmodf(hDeg, 360.0f) / 60.0f;
+        float c = v * s;
+        float x = c * (1 - fabsf(fmodf(h, 2.0f) - 1));
+        float m = v - c;
+        float r, g, b;
+
+        if (0 <= h && h < 1) {
+            r = c; g = x; b = 0;
+        } else if (1 <= h && h < 2) {
+            r = x; g = c; b = 0;
+        } else if (2 <= h && h < 3) {
+            r = 0; g = c; b = x;
+        } else if (3 <= h && h < 4) {
+            r = 0; g = x; b = c;
+        } else if (4 <= h && h < 5) {
+            r = x; g = 0; b = c;
+        } else {
+            r = c; g = 0; b = x;
+        }
+
+        rOut = static_cast<int>((r + m) * 2047);
+        gOut = static_cast<int>((g + m) * 2047);
+        bOut = static_cast<int>((b + m) * 2047);
+    }
+
+    void reset() {
+        hue = 0.0f;
+        lastMillis = 0;
+    }
+
+    // Restart timing without losing the current hue (used while OFF).
+    void pauseClock() {
+        lastMillis = 0;
+    }
+
+    float getHue() const {
+        return hue;
+    }
+
+    void step(unsigned long nowMillis, float hz, int &r, int &g, int &b) {
+        float dt = advanceSeconds(nowMillis);
+        hue += dt * hz * 360.0f;
+        if (hue > 720.0f) {
+            hue = fmodf(hue, 360.0f);
+        }
+        hsvToRgb11(hue, 1.0f, 1.0f, r, g, b);
+    }
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include <Arduino.h>
+#include "LEDController.h"
+#include "Trace.h"
+
+enum class OperationMode {
+    PARTY,
+    WIFI,
+    OFF,
+};
+
+inline const char *operationModeName(OperationMode mode) {
+    switch (mode) {
+    case OperationMode::PARTY:
+        return "party";
+    case OperationMode::WIFI:
+        return "wifi";
+    case OperationMode::OFF:
+        return "off";
+    default:
+        return "unknown";
+    }
+}
+
+// Accepts the names used by the web UI plus a few aliases, case-insensitively.
+inline bool parseOperationMode(const char *value, OperationMode &modeOut) {
+    if (strcasecmp(value, "party") == 0) {
+        modeOut = OperationMode::PARTY;
+        return true;
+    }
+    if (strcasecmp(value, "wifi") == 0 || strcasecmp(value, "remote") == 0) {
+        modeOut = OperationMode::WIFI;
+        return true;
+    }
+    if (strcasecmp(value, "off") == 0 || strcasecmp(value, "sleep") == 0) {
+        modeOut = OperationMode::OFF;
+        return true;
+    }
+    return false;
+}
+
+class StateHandler {
+private:
+    OperationMode currentMode;
+    LampLEDController &ledController;
+    float partyHz = 0.6f; // cycles per second
+
+public:
+    StateHandler(LampLEDController &controller)
+        : currentMode(OperationMode::WIFI), ledController(controller) {}
+
+    void begin() {
+        currentMode = OperationMode::WIFI;
+    }
+
+    OperationMode getCurrentMode() const {
+        return currentMode;
+    }
+
+    void setMode(OperationMode mode) {
+        if (mode != currentMode) {
+            traceEvent(TraceEvent::MODE, static_cast<uint8_t>(mode), static_cast<uint16_t>(currentMode));
+        }
+        currentMode = mode;
+    }
+
+    void setPartyHz(float hz) {
+        partyHz = constrain(hz, 0.05f, 5.0f); // clamp to sensible range
+    }
+
+    float getPartyHz() const {
+        return partyHz;
+    }
+
+    // Records enough state for tools/trace_replay to start from this point.
+    void traceSnapshot() {
+        int r, g, b;
+        ledController.getRequestedValues(r, g, b);
+        traceEvent(TraceEvent::SNAPSHOT, static_cast<uint8_t>(currentMode),
+                   ledController.isUnlocked() ? 1 : 0, static_cast<uint32_t>(partyHz * 1000.0f + 0.5f));
+        traceEvent(TraceEvent::SNAPSHOT_COLOR, 0, static_cast<uint16_t>(r),
+                   (static_cast<uint32_t>(g) << 16) | static_cast<uint32_t>(b));
+    }
+
+    void update() {
+        // Button handling disabled to avoid conflicts with remote control.
+    }
+};
+
+#endif
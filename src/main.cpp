@@ -3,100 +3,104 @@
 #include "WiFiManager.h"
 #include "State.h"
 #include "DebugLog.h"
-#include <math.h>
+#include "OtaUpdater.h"
+#include "Scheduler.h"
+#include "PartyRenderer.h"
+#include "Trace.h"
+#include "StallMonitor.h"
+#include "LampCommands.h"
+#include "MqttBridge.h"
+#include "PowerGovernor.h"
+#include "SerialLink.h"
+#if ARDUINO_USB_MODE && ARDUINO_USB_CDC_ON_BOOT
+#include <soc/soc.h>
+#include <soc/usb_serial_jtag_reg.h>
+#endif
 
 const int RED_PIN = 5;
 const int GREEN_PIN = 6;
 const int BLUE_PIN = 7;
 
+// Logical channel -> GPIO/LEDC channel/trim. Red and blue are wired to each
+// other's pins on this board, so logical red drives BLUE_PIN and vice versa.
+static const LedChannelConfig LED_CHANNEL_MAP[LAMP_LED_CHANNELS] = {
+    {BLUE_PIN, 0, RED_TRIM},
+    {GREEN_PIN, 1, GREEN_TRIM},
+    {RED_PIN, 2, BLUE_TRIM},
+};
+
 //unsigned long potTimer = 0;
 //const int potInterval = 50; // Check every 50ms
 //bool potChanged = false;
 
-LEDController ledController(
-    RED_PIN, GREEN_PIN, BLUE_PIN,
-    0, 1, 2);
+LampLEDController ledController(LED_CHANNEL_MAP);
 
 WiFiManager wifiManager(ledController);
 StateHandler stateHandler(ledController);
+Scheduler scheduler(ledController, stateHandler);
+LampCommands lampCommands(ledController, stateHandler, scheduler);
+MqttBridge mqttBridge(lampCommands);
+SerialLink serialLink(Serial, lampCommands);
 
 // Simple party mode helpers
-float partyHue = 0.0f; // degrees
-unsigned long lastPartyMillis = 0;
+PartyRenderer partyRenderer;
 OperationMode lastMode = OperationMode::WIFI;
 
-void hsvToRgb11(float hDeg, float s, float v, int &rOut, int &gOut, int &bOut)
+// Keep a freshly installed OTA image in pending state until WiFiManager
+// confirms it; OtaUpdater::checkBootHealth() rolls back if it never does.
+extern "C" bool verifyRollbackLater()
 {
-  float h = fmodf(hDeg, 360.0f) / 60.0f;
-  float c = v * s;
-  float x = c * (1 - fabsf(fmodf(h, 2.0f) - 1));
-  float m = v - c;
-  float r, g, b;
-
-  if (0 <= h && h < 1)
-  {
-    r = c;
-    g = x;
-    b = 0;
-  }
-  else if (1 <= h && h < 2)
-  {
-    r = x;
-    g = c;
-    b = 0;
-  }
-  else if (2 <= h && h < 3)
-  {
-    r = 0;
-    g = c;
-    b = x;
-  }
-  else if (3 <= h && h < 4)
-  {
-    r = 0;
-    g = x;
-    b = c;
-  }
-  else if (4 <= h && h < 5)
-  {
-    r = x;
-    g = 0;
-    b = c;
-  }
-  else
-  {
-    r = c;
-    g = 0;
-    b = x;
-  }
-
-  rOut = static_cast<int>((r + m) * 2047);
-  gOut = static_cast<int>((g + m) * 2047);
-  bOut = static_cast<int>((b + m) * 2047);
+  return true;
 }
 
-float advanceSeconds(unsigned long &lastTimestamp, unsigned long nowMillis)
+#if ARDUINO_USB_MODE && ARDUINO_USB_CDC_ON_BOOT
+// An attached host sends a start-of-frame every 1 ms, so the 11-bit frame
+// counter only stands still without one. Two still readings in a row rule
+// out a sample that landed on the same count after a wrap.
+static bool usbHostPresent()
 {
-  if (lastTimestamp == 0)
+  static uint32_t lastFrame = 0;
+  static uint8_t stillReadings = 0;
+  const uint32_t frame = REG_GET_FIELD(USB_SERIAL_JTAG_FRAM_NUM_REG, USB_SERIAL_JTAG_SOF_FRAME_INDEX);
+  if (frame != lastFrame)
   {
-    lastTimestamp = nowMillis;
-    return 0.0f;
+    stillReadings = 0;
   }
-  float dt = (nowMillis - lastTimestamp) / 1000.0f;
-  lastTimestamp = nowMillis;
-  return dt;
+  else if (stillReadings < 2)
+  {
+    stillReadings++;
+  }
+  lastFrame = frame;
+  return stillReadings < 2;
 }
+#endif
 
 void setup()
 {
+  Serial.setRxBufferSize(1024); // a few hundred frames/s arrive in bursts between loop() passes
   Serial.begin(115200);
+#if ARDUINO_USB_MODE && ARDUINO_USB_CDC_ON_BOOT
+  // Serial frames must not wait out an idle loop's sleep either
+  Serial.onEvent(ARDUINO_HW_CDC_RX_EVENT, [](void *, esp_event_base_t, int32_t, void *) { powerGovernor.wake(); });
+#endif
+  OtaUpdater::checkBootHealth();
   logStatus("BOOT", "Firmware start, free heap=%u", ESP.getFreeHeap());
   ledController.begin();
   stateHandler.begin();
+  stateHandler.traceSnapshot();
   logStatus("BOOT", "LED and state initialized");
+  scheduler.begin();
   wifiManager.attachStateHandler(&stateHandler);
+  wifiManager.attachScheduler(&scheduler);
+  wifiManager.attachCommands(&lampCommands);
+  wifiManager.attachMqtt(&mqttBridge);
   logStatus("BOOT", "Starting WiFi manager");
   wifiManager.begin();
+  mqttBridge.begin();
+  stallMonitor.begin();
+  powerGovernor.begin();
+  ledController.setFlushHook([] { powerGovernor.notePwmWrite(); });
+  enableLoopWDT(); // a frozen loop() now resets instead of hanging; StallMonitor explains why on the next boot
   logStatus("BOOT", "Setup complete, initial mode=WIFI");
 }
 
@@ -107,20 +111,30 @@ void loop()
   const unsigned long UPDATE_INTERVAL = 20;
   const unsigned long HEARTBEAT_INTERVAL = 2000;
 
+  stallMonitor.beatRender();
+
+  // Every pass, not just render ticks: streamed frames land within one loop
+  if (serialLink.poll())
+  {
+    powerGovernor.wake();
+  }
+
   unsigned long currentMillis = millis();
   if (currentMillis - lastUpdate >= UPDATE_INTERVAL)
   {
     lastUpdate = currentMillis;
     stateHandler.update();
+    lampCommands.applyQueued();
     wifiManager.update(stateHandler.getCurrentMode());
+    scheduler.tick(currentMillis);
+    mqttBridge.update(currentMillis);
 
     OperationMode mode = stateHandler.getCurrentMode();
     if (mode != lastMode)
     {
       if (mode != OperationMode::PARTY)
       {
-        partyHue = 0.0f;
-        lastPartyMillis = 0;
+        partyRenderer.reset();
       }
       logStatus("MODE", "Mode changed to %s", mode == OperationMode::PARTY   ? "PARTY" :
                                                  mode == OperationMode::WIFI    ? "WIFI" :
@@ -131,20 +145,14 @@ void loop()
     {
     case OperationMode::PARTY:
     {
-      float dt = advanceSeconds(lastPartyMillis, currentMillis);
-      float hz = stateHandler.getPartyHz();
-      partyHue += dt * hz * 360.0f;
-      if (partyHue > 720.0f)
-      {
-        partyHue = fmodf(partyHue, 360.0f);
-      }
+      traceEvent(TraceEvent::TICK, 0, 0, currentMillis);
       int r, g, b;
-      hsvToRgb11(partyHue, 1.0f, 1.0f, r, g, b);
+      partyRenderer.step(currentMillis, stateHandler.getPartyHz(), r, g, b);
       ledController.setPWMDirectly(r, g, b);
       break;
     }
     case OperationMode::OFF:
-      lastPartyMillis = 0;
+      partyRenderer.pauseClock();
       break;
     case OperationMode::WIFI:
       // LED control happens via WiFi in WIFI mode
@@ -158,7 +166,15 @@ void loop()
   {
     lastHeartbeat = currentMillis;
     wifiManager.logStatusSnapshot(stateHandler.getCurrentMode());
+    stateHandler.traceSnapshot();
   }
 
-  delay(2);
+  // Sleeps 2 ms while animating; otherwise blocks until a command or the next
+  // housekeeping deadline so the CPU and radio can idle.
+  const bool busy = stateHandler.getCurrentMode() == OperationMode::PARTY || scheduler.isFading();
+#if ARDUINO_USB_MODE && ARDUINO_USB_CDC_ON_BOOT
+  powerGovernor.setUsbHost(usbHostPresent()); // SAVER would otherwise light-sleep the serial link away
+#endif
+  // LEDC stops in light sleep, so only when nothing is lit
+  powerGovernor.idle(busy, ledController.isDark(), millis());
 }
@@ -0,0 +1,105 @@
+#!/usr/bin/env python3
+"""Pack data/ into include/WebAssets.h as gzip-compressed, content-hashed byte arrays.
+
+Runs automatically as a PlatformIO pre-build script (see platformio.ini) and
+can also be run by hand: python tools/embed_assets.py
+"""
+
+import gzip
+import hashlib
+import os
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".js": "text/javascript",
+    ".css": "text/css",
+    ".json": "application/json",
+    ".svg": "image/svg+xml",
+    ".ico": "image/x-icon",
+}
+
+# Third-party files that never change between firmware builds.
+IMMUTABLE = {"iro.min.js"}
+
+
+def project_dir():
+    try:
+        Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+        return env["PROJECT_DIR"]  # noqa: F821
+    except NameError:
+        return os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def c_array(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join(f"0x{b:02x}" for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def build(root):
+    data_dir = os.path.join(root, "data")
+    out_path = os.path.join(root, "include", "WebAssets.h")
+
+    assets = []
+    bundle_hash = hashlib.sha256()
+    for name in sorted(os.listdir(data_dir)):
+        path = os.path.join(data_dir, name)
+        ext = os.path.splitext(name)[1]
+        if not os.path.isfile(path) or ext not in CONTENT_TYPES:
+            continue
+        with open(path, "rb") as f:
+            raw = f.read()
+        packed = gzip.compress(raw, compresslevel=9, mtime=0)
+        digest = hashlib.sha256(raw).hexdigest()
+        bundle_hash.update(name.encode() + b"\0" + raw)
+        assets.append((name, CONTENT_TYPES[ext], packed, digest[:16]))
+
+    out = [
+        "// Generated by tools/embed_assets.py from data/ - do not edit.",
+        "#ifndef WEB_ASSETS_H",
+        "#define WEB_ASSETS_H",
+        "",
+        "#include <stddef.h>",
+        "#include <stdint.h>",
+        "",
+        "struct WebAsset",
+        "{",
+        "    const char *path;",
+        "    const char *contentType;",
+        "    const uint8_t *data; // gzip-compressed",
+        "    size_t length;",
+        "    const char *etag;",
+        "    bool immutable;",
+        "};",
+        "",
+    ]
+    for index, (name, _, packed, _) in enumerate(assets):
+        out.append(f"// {name}")
+        out.append(f"static constexpr uint8_t WEB_ASSET_{index}[] = {{")
+        out.append(c_array(packed))
+        out.append("};")
+        out.append("")
+    out.append("static constexpr WebAsset WEB_ASSETS[] = {")
+    for index, (name, ctype, packed, etag) in enumerate(assets):
+        immutable = "true" if name in IMMUTABLE else "false"
+        out.append(f'    {{"/{name}", "{ctype}", WEB_ASSET_{index}, {len(packed)}, "\\"{etag}\\"", {immutable}}},')
+    out.append("};")
+    out.append("")
+    out.append(f"static constexpr size_t WEB_ASSET_COUNT = {len(assets)};")
+    out.append(f'static constexpr const char *WEB_ASSETS_HASH = "{bundle_hash.hexdigest()[:16]}";')
+    out.append("")
+    out.append("#endif")
+    text = "\n".join(out) + "\n"
+
+    # Only touch the header when the bundle changed so incremental builds stay incremental.
+    if os.path.exists(out_path):
+        with open(out_path, "r") as f:
+            if f.read() == text:
+                return
+    with open(out_path, "w") as f:
+        f.write(text)
+    print(f"embed_assets: packed {len(assets)} files into {out_path} (bundle {bundle_hash.hexdigest()[:16]})")
+
+
+build(project_dir())
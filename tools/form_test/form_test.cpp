@@ -0,0 +1,137 @@
+// Host check of the zero-allocation control-body parser: FormFields decoding
+// and limits, FormSlotPool ownership and stale-slot reuse, and a million
+// claim/parse/find/release cycles with every heap allocation counted.
+//
+//   make -C tools form_test && tools/build/form_test
+
+#include <Arduino.h>
+#include <new>
+#include "FormParser.h"
+
+static size_t allocations = 0;
+
+// noinline: inlined into the probe below, g++ 12 pairs malloc with delete
+// and warns (-Wmismatched-new-delete).
+__attribute__((noinline)) void *operator new(size_t size) {
+    allocations++;
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept { free(p); }
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static bool parseText(FormFields &fields, const char *text) {
+    return fields.parse(reinterpret_cast<const uint8_t *>(text), strlen(text));
+}
+
+static bool equals(const char *value, const char *expected) {
+    return value != nullptr && strcmp(value, expected) == 0;
+}
+
+static void testFields() {
+    FormFields fields;
+    expect(parseText(fields, "r=12&g=40&b=255"), "rgb body parses");
+    expect(fields.size() == 3, "rgb body has three fields");
+    expect(equals(fields.get("g"), "40"), "g value");
+    expect(fields.get("x") == nullptr, "missing key is null");
+
+    expect(parseText(fields, "scene=deep%20ocean&name=a+b&bad=%zz"), "encoded body parses");
+    expect(equals(fields.get("scene"), "deep ocean"), "percent decoding");
+    expect(equals(fields.get("name"), "a b"), "plus decoding");
+    expect(equals(fields.get("bad"), "%zz"), "invalid escape kept");
+
+    expect(parseText(fields, "=1&&novalue&mode=party"), "junk pairs skipped");
+    expect(fields.size() == 1 && equals(fields.get("mode"), "party"), "only the valid pair kept");
+
+    expect(!parseText(fields, ""), "empty body rejected");
+    expect(!parseText(fields, "novalue"), "body without pairs rejected");
+
+    char big[FormFields::MAX_BODY + 1];
+    memset(big, 'a', sizeof(big) - 1);
+    big[0] = 'k';
+    big[1] = '=';
+    big[sizeof(big) - 1] = '\0';
+    expect(!parseText(fields, big), "oversized body rejected");
+    big[FormFields::MAX_BODY - 1] = '\0';
+    expect(parseText(fields, big), "largest body accepted");
+
+    expect(parseText(fields, "a=1&b=2&c=3&d=4&e=5&f=6&g=7&h=8&i=9"), "many fields parse");
+    expect(fields.size() == FormFields::MAX_FIELDS && fields.get("i") == nullptr, "fields capped");
+
+    int number;
+    float real;
+    expect(formParseInt("-42", number) && number == -42, "int parses");
+    expect(!formParseInt("12x", number) && !formParseInt("", number) && !formParseInt(nullptr, number),
+           "int rejects garbage");
+    expect(formParseFloat("1.5", real) && real == 1.5f, "float parses");
+    expect(!formParseFloat("nan", real) && !formParseFloat("1.5.", real), "float rejects garbage");
+}
+
+static void testPool() {
+    FormSlotPool<2> pool;
+    int a = 0, b = 0, c = 0;
+    expect(pool.claim(&a, 0) != nullptr && pool.claim(&b, 0) != nullptr, "two slots claimed");
+    expect(pool.claim(&a, 10) == pool.find(&a), "owner reclaims its own slot");
+    expect(pool.claim(&c, 10) == nullptr && pool.droppedCount() == 1, "full pool drops");
+    expect(pool.claim(&c, FormSlotPool<2>::STALE_MS + 20) != nullptr, "stale slot reused");
+    expect(pool.find(&c) != nullptr && pool.inUse() == 2, "new owner found");
+    pool.release(&c);
+    pool.release(&b);
+    expect(pool.inUse() == 0 && pool.find(&b) == nullptr, "released slots free");
+}
+
+// The /postRGB path: the body callback claims and parses, the request
+// callback reads and releases.
+static void testNoAllocation() {
+    static FormSlotPool<6> pool;
+    const size_t probe = allocations;
+    delete new int(0);
+    expect(allocations == probe + 1, "allocation counter is active");
+
+    const size_t before = allocations;
+    char body[32];
+    uint32_t checksum = 0;
+    for (uint32_t i = 0; i < 1000000; i++) {
+        const int len = snprintf(body, sizeof(body), "r=%u&g=%u&b=%u", i % 256, (i / 7) % 256, (i / 13) % 256);
+        const void *request = reinterpret_cast<const void *>(static_cast<uintptr_t>(0x1000 + (i % 5) * 16));
+        FormFields *fields = pool.claim(request, i);
+        if (!fields || !fields->parse(reinterpret_cast<const uint8_t *>(body), static_cast<size_t>(len))) {
+            expect(false, "soak parse");
+            break;
+        }
+        int r, g, b;
+        FormFields *found = pool.find(request);
+        if (!found || !formParseInt(found->get("r"), r) || !formParseInt(found->get("g"), g) ||
+            !formParseInt(found->get("b"), b) || r != static_cast<int>(i % 256)) {
+            expect(false, "soak values");
+            break;
+        }
+        checksum += r + g + b;
+        pool.release(request);
+    }
+    const size_t used = allocations - before;
+    printf("1000000 parses, %zu allocations, checksum %u\n", used, checksum);
+    expect(used == 0, "parser and pool do not allocate");
+    expect(pool.inUse() == 0 && pool.droppedCount() == 0, "soak leaves the pool empty");
+}
+
+int main() {
+    testFields();
+    testPool();
+    testNoAllocation();
+    printf("%s\n", failures ? "form_test: FAILED" : "form_test: ok");
+    return failures ? 1 : 0;
+}
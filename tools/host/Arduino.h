@@ -0,0 +1,146 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Minimal Arduino surface for building firmware libraries natively on the
+// host. Time is virtual: it only moves when a tool calls hostAdvanceMicros()
+// or hostSetMicros(), or when firmware code blocks in delay() or a task
+// notification wait, which keeps replays and simulations deterministic.
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/time.h>
+#include <time.h>
+#include <string>
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+void ledcSetup(int channel, int frequency, int resolution);
+void ledcAttachPin(int pin, int channel);
+void ledcWrite(int channel, int duty);
+
+// The wall clock follows the virtual clock: it reads 0 (not set) until the
+// firmware calls settimeofday(), as on a freshly booted lamp.
+time_t hostTime(time_t *out);
+int hostSettimeofday(const struct timeval *tv, const void *tz);
+#define time(out) hostTime(out)
+#define settimeofday(tv, tz) hostSettimeofday(tv, tz)
+
+class String {
+public:
+    String(const char *text = "") : text(text ? text : "") {}
+    const char *c_str() const { return text.c_str(); }
+    size_t length() const { return text.size(); }
+    bool operator==(const char *other) const { return text == other; }
+
+private:
+    std::string text;
+};
+
+// Byte stream interface used by transports (SerialLink); host tools supply
+// their own implementation, e.g. over a pseudo-terminal.
+class Stream {
+public:
+    virtual ~Stream() {}
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual size_t write(const uint8_t *data, size_t len) = 0;
+};
+
+// Output only; reads see an idle port.
+class HostSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    void setRxBufferSize(size_t) {}
+    operator bool() const;
+    size_t printf(const char *fmt, ...);
+    size_t print(const char *text);
+    size_t println(const char *text = "");
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    size_t write(const uint8_t *data, size_t len) override;
+};
+
+extern HostSerial Serial;
+
+class HostEsp {
+public:
+    uint32_t getFreeHeap() const;
+    void restart();
+};
+
+extern HostEsp ESP;
+
+// --- FreeRTOS / arduino-esp32 ------------------------------------------
+// One task (loop()) runs; xTaskCreate() accepts a task but never runs it.
+// Ticks are 1 ms, as on the lamp.
+
+typedef void *TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
+BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stackDepth, void *arg, UBaseType_t priority,
+                       TaskHandle_t *created);
+TickType_t xTaskGetTickCount();
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment);
+TaskHandle_t xTaskGetHandle(const char *name);
+UBaseType_t uxTaskPriorityGet(TaskHandle_t task);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+void enableLoopWDT();
+bool setCpuFrequencyMhz(uint32_t mhz);
+uint32_t getCpuFrequencyMhz();
+
+// --- host-only controls -------------------------------------------------
+
+uint64_t hostMicros();
+void hostSetMicros(uint64_t now);
+void hostAdvanceMicros(uint64_t delta);
+void hostSetSerialEnabled(bool enabled);
+void hostSetFreeHeap(uint32_t bytes);
+
+typedef void (*HostLedcWriteHook)(int channel, int duty);
+void hostSetLedcWriteHook(HostLedcWriteHook hook);
+
+// Redirects Serial output (when enabled) away from stderr.
+typedef void (*HostSerialWriteHook)(const char *text, size_t len);
+void hostSetSerialWriteHook(HostSerialWriteHook hook);
+
+// Blocking calls (delay(), ulTaskNotifyTake()) pass their wait to this hook
+// so a simulator can run whatever else is due before untilUs, e.g. web
+// requests that would arrive on other tasks. Each call must either run one
+// event (moving the clock to its time) or move the clock to untilUs.
+typedef void (*HostIdleHook)(uint64_t untilUs);
+void hostSetIdleHook(HostIdleHook hook);
+// Spends time up to untilUs the way delay() does.
+void hostIdle(uint64_t untilUs);
+
+#endif
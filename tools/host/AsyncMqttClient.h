@@ -0,0 +1,84 @@
+#ifndef HOST_ASYNC_MQTT_CLIENT_H
+#define HOST_ASYNC_MQTT_CLIENT_H
+
+#include <Arduino.h>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+// Client wired to an in-process loopback broker: connect() succeeds at once
+// whenever a server is set, publishes are kept (retained ones per topic)
+// and hostMqttDeliver() feeds messages to matching subscriptions.
+
+enum class AsyncMqttClientDisconnectReason : uint8_t {
+    TCP_DISCONNECTED = 0,
+    MQTT_SERVER_UNAVAILABLE = 3,
+};
+
+struct AsyncMqttClientMessageProperties {
+    uint8_t qos;
+    bool dup;
+    bool retain;
+};
+
+class AsyncMqttClient {
+public:
+    typedef std::function<void(bool)> OnConnectUserCallback;
+    typedef std::function<void(AsyncMqttClientDisconnectReason)> OnDisconnectUserCallback;
+    typedef std::function<void(char *, char *, AsyncMqttClientMessageProperties, size_t, size_t, size_t)>
+        OnMessageUserCallback;
+
+    AsyncMqttClient();
+    ~AsyncMqttClient();
+
+    AsyncMqttClient &setClientId(const char *) { return *this; }
+    AsyncMqttClient &setKeepAlive(uint16_t) { return *this; }
+    AsyncMqttClient &setWill(const char *, uint8_t, bool, const char * = nullptr, size_t = 0) { return *this; }
+    AsyncMqttClient &setServer(const char *host, uint16_t) {
+        server = host ? host : "";
+        return *this;
+    }
+    AsyncMqttClient &setCredentials(const char *, const char * = nullptr) { return *this; }
+    AsyncMqttClient &onConnect(OnConnectUserCallback callback) {
+        connectCallback = callback;
+        return *this;
+    }
+    AsyncMqttClient &onDisconnect(OnDisconnectUserCallback callback) {
+        disconnectCallback = callback;
+        return *this;
+    }
+    AsyncMqttClient &onMessage(OnMessageUserCallback callback) {
+        messageCallback = callback;
+        return *this;
+    }
+
+    bool connected() const { return isConnected; }
+    void connect();
+    void disconnect(bool force = false);
+    uint16_t publish(const char *topic, uint8_t qos, bool retain, const char *payload = nullptr, size_t length = 0,
+                     bool dup = false, uint16_t messageId = 0);
+    uint16_t subscribe(const char *topic, uint8_t qos);
+
+    // host-only
+    bool hostDeliver(const char *topic, const char *payload);
+    const std::map<std::string, std::string> &hostRetained() const { return retained; }
+    uint32_t hostPublishCount() const { return publishCount; }
+
+private:
+    std::string server;
+    bool isConnected = false;
+    OnConnectUserCallback connectCallback;
+    OnDisconnectUserCallback disconnectCallback;
+    OnMessageUserCallback messageCallback;
+    std::vector<std::string> subscriptions;
+    std::map<std::string, std::string> retained;
+    uint32_t publishCount = 0;
+};
+
+// Delivers to every client in the process; returns true if one subscribed.
+bool hostMqttDeliver(const char *topic, const char *payload);
+// Retained messages and publish count of the first client (the lamp's bridge).
+const AsyncMqttClient *hostMqttClient();
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef HOST_ASYNCTCP_H
+#define HOST_ASYNCTCP_H
+
+#include <WiFi.h>
+
+// The client side of a connection, as far as request handlers see it.
+class AsyncClient {
+public:
+    explicit AsyncClient(uint32_t remote) : remote(remote) {}
+    IPAddress remoteIP() const { return IPAddress(remote); }
+
+private:
+    uint32_t remote;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef HOST_ESPASYNCWEBSERVER_H
+#define HOST_ESPASYNCWEBSERVER_H
+
+#include <Arduino.h>
+#include <AsyncTCP.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// In-process stand-in for ESPAsyncWebServer. Nothing listens on a socket:
+// a simulator hands requests to hostHttpOpen(), which runs the registered
+// handlers the way the library does (first matching route wins, raw bodies
+// go to the body callback in TCP-segment-sized chunks, url-encoded bodies
+// become POST params) and keeps the connection open until hostHttpClose().
+
+typedef uint8_t WebRequestMethodComposite;
+enum WebRequestMethod : uint8_t {
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111,
+};
+
+class AsyncWebServerRequest;
+
+typedef std::function<void(AsyncWebServerRequest *)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *, const String &, size_t, uint8_t *, size_t, bool)>
+    ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest *, uint8_t *, size_t, size_t, size_t)> ArBodyHandlerFunction;
+typedef std::function<void()> ArDisconnectHandler;
+typedef std::function<size_t(uint8_t *, size_t, size_t)> AwsResponseFiller;
+
+class AsyncWebParameter {
+public:
+    AsyncWebParameter(const char *name, const char *value, bool post) : paramName(name), paramValue(value), post(post) {}
+    const String &name() const { return paramName; }
+    const String &value() const { return paramValue; }
+    bool isPost() const { return post; }
+
+private:
+    String paramName;
+    String paramValue;
+    bool post;
+};
+
+class AsyncWebServerResponse {
+public:
+    AsyncWebServerResponse(int code, const char *contentType, const std::string &content)
+        : code(code), contentType(contentType ? contentType : ""), content(content) {}
+    void addHeader(const char *name, const char *value) { headers.push_back(std::make_pair(name, value)); }
+
+    int code;
+    std::string contentType;
+    std::string content;
+    std::vector<std::pair<std::string, std::string> > headers;
+};
+
+class AsyncWebServerRequest {
+public:
+    AsyncWebServerRequest(uint8_t method, const char *url, uint32_t clientIp);
+    ~AsyncWebServerRequest();
+
+    AsyncClient *client() { return &remote; }
+    uint8_t method() const { return requestMethod; }
+    const String &url() const { return path; }
+
+    void onDisconnect(ArDisconnectHandler handler) { disconnectHandler = handler; }
+
+    bool hasHeader(const char *name) const;
+    String header(const char *name) const;
+    size_t params() const { return paramList.size(); }
+    AsyncWebParameter *getParam(size_t index) { return index < paramList.size() ? &paramList[index] : nullptr; }
+
+    AsyncWebServerResponse *beginResponse(int code, const char *contentType = "", const char *content = "");
+    AsyncWebServerResponse *beginResponse_P(int code, const char *contentType, const uint8_t *content, size_t len);
+    AsyncWebServerResponse *beginResponse(const char *contentType, size_t len, AwsResponseFiller filler);
+    void send(AsyncWebServerResponse *response);
+    void send(int code, const char *contentType = "", const char *content = "");
+
+private:
+    friend class AsyncWebServer;
+    friend AsyncWebServerRequest *hostHttpOpen(const char *, const char *, const char *, const char *, uint32_t,
+                                               const char *const *);
+    friend void hostHttpClose(AsyncWebServerRequest *);
+    friend const AsyncWebServerResponse *hostHttpResponse(const AsyncWebServerRequest *);
+
+    uint8_t requestMethod;
+    String path;
+    AsyncClient remote;
+    std::vector<AsyncWebParameter> paramList;
+    std::vector<std::pair<std::string, std::string> > headerList;
+    ArDisconnectHandler disconnectHandler;
+    AsyncWebServerResponse *response = nullptr;
+
+    void addParams(const char *encoded, bool post);
+};
+
+class DefaultHeaders {
+public:
+    static DefaultHeaders &Instance();
+    void addHeader(const char *name, const char *value) { headers.push_back(std::make_pair(name, value)); }
+    const std::vector<std::pair<std::string, std::string> > &all() const { return headers; }
+
+private:
+    std::vector<std::pair<std::string, std::string> > headers;
+};
+
+class AsyncWebServer {
+public:
+    explicit AsyncWebServer(uint16_t port) : port(port) {}
+
+    void on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+            ArUploadHandlerFunction onUpload = nullptr, ArBodyHandlerFunction onBody = nullptr);
+    void begin();
+    void end();
+
+private:
+    friend AsyncWebServerRequest *hostHttpOpen(const char *, const char *, const char *, const char *, uint32_t,
+                                               const char *const *);
+
+    struct Route {
+        std::string uri;
+        WebRequestMethodComposite method;
+        ArRequestHandlerFunction onRequest;
+        ArBodyHandlerFunction onBody;
+    };
+
+    uint16_t port;
+    std::vector<Route> routes;
+
+    const Route *match(const AsyncWebServerRequest &request) const;
+};
+
+// --- host-only ------------------------------------------------------------
+
+// Largest body chunk handed to a body callback, like one TCP segment.
+static constexpr size_t HOST_HTTP_SEGMENT = 1436;
+
+// Runs a request against the started server: `url` may carry a query string,
+// `headers` is a null-terminated list of "Name: value" strings (or null).
+// Returns null if no server is listening. The response, if any, is ready
+// when this returns; the connection stays open until hostHttpClose().
+AsyncWebServerRequest *hostHttpOpen(const char *method, const char *url, const char *body, const char *contentType,
+                                    uint32_t clientIp, const char *const *headers = nullptr);
+// Null while the handler has not answered.
+const AsyncWebServerResponse *hostHttpResponse(const AsyncWebServerRequest *request);
+// The client disconnects: fires onDisconnect and frees the request.
+void hostHttpClose(AsyncWebServerRequest *request);
+
+#endif
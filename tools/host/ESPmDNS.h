@@ -0,0 +1,14 @@
+#ifndef HOST_ESPMDNS_H
+#define HOST_ESPMDNS_H
+
+#include <Arduino.h>
+
+class MDNSResponder {
+public:
+    bool begin(const char *) { return true; }
+    void addService(const char *, const char *, uint16_t) {}
+};
+
+extern MDNSResponder MDNS;
+
+#endif
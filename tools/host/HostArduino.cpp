@@ -0,0 +1,220 @@
+#include "Arduino.h"
+#include "Preferences.h"
+#include "Update.h"
+
+HostSerial Serial;
+HostEsp ESP;
+UpdateClass Update;
+
+static uint64_t virtualMicros = 0;
+static bool serialEnabled = false;
+static HostLedcWriteHook ledcHook = nullptr;
+static HostSerialWriteHook serialHook = nullptr;
+static HostIdleHook idleHook = nullptr;
+static uint32_t freeHeap = 180 * 1024;
+static uint32_t cpuMhz = 160;
+static uint32_t notifyCount = 0;
+static int64_t wallOffsetUs = 0;
+static bool wallClockSet = false;
+
+unsigned long millis() { return static_cast<unsigned long>(virtualMicros / 1000ULL); }
+unsigned long micros() { return static_cast<unsigned long>(virtualMicros); }
+
+// Returns early once the loop task has been notified, if asked to.
+static void waitUntil(uint64_t untilUs, bool stopOnNotify) {
+    static bool inHook = false;
+    while (virtualMicros < untilUs && !(stopOnNotify && notifyCount > 0)) {
+        if (idleHook && !inHook) {
+            inHook = true; // events that delay() themselves just advance the clock
+            idleHook(untilUs);
+            inHook = false;
+        } else {
+            virtualMicros = untilUs;
+        }
+    }
+}
+
+void delay(unsigned long ms) { waitUntil(virtualMicros + ms * 1000ULL, false); }
+void hostIdle(uint64_t untilUs) { waitUntil(untilUs, false); }
+
+time_t hostTime(time_t *out) {
+    const int64_t wallUs = static_cast<int64_t>(virtualMicros) + wallOffsetUs;
+    const time_t now = wallClockSet ? static_cast<time_t>(wallUs / 1000000) : 0;
+    if (out) {
+        *out = now;
+    }
+    return now;
+}
+
+int hostSettimeofday(const struct timeval *tv, const void *) {
+    wallClockSet = true;
+    wallOffsetUs = static_cast<int64_t>(tv->tv_sec) * 1000000 + tv->tv_usec - static_cast<int64_t>(virtualMicros);
+    return 0;
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+void ledcSetup(int, int, int) {}
+void ledcAttachPin(int, int) {}
+void ledcWrite(int channel, int duty) {
+    if (ledcHook) {
+        ledcHook(channel, duty);
+    }
+}
+
+HostSerial::operator bool() const { return serialEnabled; }
+
+size_t HostSerial::printf(const char *fmt, ...) {
+    if (!serialEnabled) {
+        return 0;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int n;
+    if (serialHook) {
+        char text[512];
+        n = vsnprintf(text, sizeof(text), fmt, args);
+        if (n > 0) {
+            serialHook(text, static_cast<size_t>(n) < sizeof(text) ? static_cast<size_t>(n) : sizeof(text) - 1);
+        }
+    } else {
+        n = vfprintf(stderr, fmt, args);
+    }
+    va_end(args);
+    return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+size_t HostSerial::write(const uint8_t *data, size_t len) {
+    if (!serialEnabled) {
+        return len;
+    }
+    if (serialHook) {
+        serialHook(reinterpret_cast<const char *>(data), len);
+    } else {
+        fwrite(data, 1, len, stderr);
+    }
+    return len;
+}
+
+size_t HostSerial::print(const char *text) { return printf("%s", text); }
+size_t HostSerial::println(const char *text) { return printf("%s\n", text); }
+
+uint32_t HostEsp::getFreeHeap() const { return freeHeap; }
+
+void HostEsp::restart() {
+    fprintf(stderr, "ESP.restart() called on host\n");
+    exit(2);
+}
+
+uint64_t hostMicros() { return virtualMicros; }
+void hostSetMicros(uint64_t now) { virtualMicros = now; }
+void hostAdvanceMicros(uint64_t delta) { virtualMicros += delta; }
+void hostSetSerialEnabled(bool enabled) { serialEnabled = enabled; }
+void hostSetFreeHeap(uint32_t bytes) { freeHeap = bytes; }
+void hostSetLedcWriteHook(HostLedcWriteHook hook) { ledcHook = hook; }
+void hostSetSerialWriteHook(HostSerialWriteHook hook) { serialHook = hook; }
+void hostSetIdleHook(HostIdleHook hook) { idleHook = hook; }
+
+// --- FreeRTOS ------------------------------------------------------------
+
+static int loopTaskTag;
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return &loopTaskTag; }
+
+BaseType_t xTaskNotifyGive(TaskHandle_t) {
+    notifyCount++;
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait) {
+    if (notifyCount == 0) {
+        waitUntil(virtualMicros + ticksToWait * 1000ULL, true);
+    }
+    const uint32_t taken = notifyCount;
+    if (clearOnExit) {
+        notifyCount = 0;
+    } else if (notifyCount > 0) {
+        notifyCount--;
+    }
+    return taken;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t, TaskHandle_t *created) {
+    if (created) {
+        *created = nullptr;
+    }
+    return pdPASS;
+}
+
+TickType_t xTaskGetTickCount() { return static_cast<TickType_t>(millis()); }
+void vTaskDelayUntil(TickType_t *previousWake, TickType_t increment) {
+    *previousWake += increment;
+    waitUntil(static_cast<uint64_t>(*previousWake) * 1000ULL, false);
+}
+TaskHandle_t xTaskGetHandle(const char *) { return nullptr; }
+UBaseType_t uxTaskPriorityGet(TaskHandle_t) { return 0; }
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+
+void enableLoopWDT() {}
+bool setCpuFrequencyMhz(uint32_t mhz) {
+    cpuMhz = mhz;
+    return true;
+}
+uint32_t getCpuFrequencyMhz() { return cpuMhz; }
+
+// --- Preferences ---------------------------------------------------------
+
+static std::map<std::string, std::vector<uint8_t> > &store() {
+    static std::map<std::string, std::vector<uint8_t> > values;
+    return values;
+}
+
+bool Preferences::begin(const char *name, bool) {
+    space = name;
+    return true;
+}
+
+std::vector<uint8_t> *Preferences::find(const char *key) {
+    std::map<std::string, std::vector<uint8_t> >::iterator it = store().find(space + "/" + key);
+    return it == store().end() ? nullptr : &it->second;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+    std::vector<uint8_t> *stored = find(key);
+    return stored ? stored->size() : 0;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+    std::vector<uint8_t> *stored = find(key);
+    if (!stored || stored->size() > maxLen) {
+        return 0;
+    }
+    memcpy(buf, stored->data(), stored->size());
+    return stored->size();
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+    const uint8_t *bytes = static_cast<const uint8_t *>(value);
+    store()[space + "/" + key].assign(bytes, bytes + len);
+    return len;
+}
+
+size_t Preferences::getString(const char *key, char *value, size_t maxLen) {
+    std::vector<uint8_t> *stored = find(key);
+    if (!stored || maxLen == 0 || stored->size() >= maxLen) {
+        return 0;
+    }
+    memcpy(value, stored->data(), stored->size());
+    value[stored->size()] = '\0';
+    return stored->size() + 1;
+}
+
+size_t Preferences::putString(const char *key, const char *value) {
+    return putBytes(key, value, strlen(value));
+}
+
+void Preferences::hostReset() {
+    store().clear();
+}
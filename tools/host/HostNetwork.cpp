@@ -0,0 +1,362 @@
+#include "AsyncMqttClient.h"
+#include "ESPAsyncWebServer.h"
+#include "ESPmDNS.h"
+#include "WiFi.h"
+#include <algorithm>
+
+WiFiClass WiFi;
+MDNSResponder MDNS;
+
+// --- WiFi ----------------------------------------------------------------
+
+bool WiFiClass::mode(wifi_mode_t next) {
+    wifiMode = next;
+    if (next != WIFI_AP && next != WIFI_AP_STA) {
+        apUp = false;
+    }
+    return true;
+}
+
+bool WiFiClass::setSleep(wifi_ps_type_t type) {
+    sleepType = type;
+    return true;
+}
+
+bool WiFiClass::config(IPAddress local, IPAddress, IPAddress, IPAddress, IPAddress) {
+    staticIp = local;
+    return true;
+}
+
+wl_status_t WiFiClass::begin(const char *, const char *) {
+    joined = joinable;
+    return status();
+}
+
+bool WiFiClass::disconnect(bool) {
+    joined = false;
+    return true;
+}
+
+uint8_t *WiFiClass::macAddress(uint8_t *mac) const {
+    static const uint8_t HOST_MAC[6] = {0x02, 0x00, 0x00, 0x5e, 0x1a, 0x70}; // locally administered
+    memcpy(mac, HOST_MAC, sizeof(HOST_MAC));
+    return mac;
+}
+
+bool WiFiClass::softAP(const char *, const char *) {
+    apUp = true;
+    return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool) {
+    apUp = false;
+    return true;
+}
+
+// --- web server ----------------------------------------------------------
+
+static AsyncWebServer *listening = nullptr;
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static std::string urlDecode(const std::string &text) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '+') {
+            out += ' ';
+        } else if (text[i] == '%' && i + 2 < text.size() && hexValue(text[i + 1]) >= 0 && hexValue(text[i + 2]) >= 0) {
+            out += static_cast<char>(hexValue(text[i + 1]) * 16 + hexValue(text[i + 2]));
+            i += 2;
+        } else {
+            out += text[i];
+        }
+    }
+    return out;
+}
+
+AsyncWebServerRequest::AsyncWebServerRequest(uint8_t method, const char *url, uint32_t clientIp)
+    : requestMethod(method), remote(clientIp) {
+    const char *query = strchr(url, '?');
+    path = String(query ? std::string(url, query).c_str() : url);
+    if (query) {
+        addParams(query + 1, false);
+    }
+}
+
+AsyncWebServerRequest::~AsyncWebServerRequest() { delete response; }
+
+void AsyncWebServerRequest::addParams(const char *encoded, bool post) {
+    std::string text(encoded);
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('&', start);
+        if (end == std::string::npos) {
+            end = text.size();
+        }
+        const std::string pair = text.substr(start, end - start);
+        const size_t eq = pair.find('=');
+        if (eq != std::string::npos && eq > 0) {
+            paramList.push_back(AsyncWebParameter(urlDecode(pair.substr(0, eq)).c_str(),
+                                                  urlDecode(pair.substr(eq + 1)).c_str(), post));
+        }
+        start = end + 1;
+    }
+}
+
+bool AsyncWebServerRequest::hasHeader(const char *name) const {
+    for (size_t i = 0; i < headerList.size(); i++) {
+        if (strcasecmp(headerList[i].first.c_str(), name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+String AsyncWebServerRequest::header(const char *name) const {
+    for (size_t i = 0; i < headerList.size(); i++) {
+        if (strcasecmp(headerList[i].first.c_str(), name) == 0) {
+            return String(headerList[i].second.c_str());
+        }
+    }
+    return String();
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(int code, const char *contentType, const char *content) {
+    return new AsyncWebServerResponse(code, contentType, content ? content : "");
+}
+
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse_P(int code, const char *contentType,
+                                                               const uint8_t *content, size_t len) {
+    return new AsyncWebServerResponse(code, contentType, std::string(reinterpret_cast<const char *>(content), len));
+}
+
+// The library pulls the filler as the socket drains; here it is drained at once.
+AsyncWebServerResponse *AsyncWebServerRequest::beginResponse(const char *contentType, size_t len,
+                                                             AwsResponseFiller filler) {
+    std::string content;
+    uint8_t chunk[HOST_HTTP_SEGMENT];
+    while (content.size() < len) {
+        const size_t n = filler(chunk, std::min(sizeof(chunk), len - content.size()), content.size());
+        if (n == 0) {
+            break;
+        }
+        content.append(reinterpret_cast<const char *>(chunk), n);
+    }
+    return new AsyncWebServerResponse(200, contentType, content);
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse *next) {
+    if (response) {
+        delete next; // the library ignores a second response too
+        return;
+    }
+    const std::vector<std::pair<std::string, std::string> > &defaults = DefaultHeaders::Instance().all();
+    next->headers.insert(next->headers.begin(), defaults.begin(), defaults.end());
+    response = next;
+}
+
+void AsyncWebServerRequest::send(int code, const char *contentType, const char *content) {
+    send(beginResponse(code, contentType, content));
+}
+
+DefaultHeaders &DefaultHeaders::Instance() {
+    static DefaultHeaders instance;
+    return instance;
+}
+
+void AsyncWebServer::on(const char *uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest,
+                        ArUploadHandlerFunction, ArBodyHandlerFunction onBody) {
+    Route route = {uri, method, onRequest, onBody};
+    routes.push_back(route);
+}
+
+void AsyncWebServer::begin() { listening = this; }
+
+void AsyncWebServer::end() {
+    if (listening == this) {
+        listening = nullptr;
+    }
+}
+
+// Same rule as AsyncCallbackWebHandler::canHandle(): the exact path or any
+// path below it, in registration order.
+const AsyncWebServer::Route *AsyncWebServer::match(const AsyncWebServerRequest &request) const {
+    const std::string url = request.url().c_str();
+    for (size_t i = 0; i < routes.size(); i++) {
+        const Route &route = routes[i];
+        if (!(route.method & request.method())) {
+            continue;
+        }
+        if (url == route.uri || url.compare(0, route.uri.size() + 1, route.uri + "/") == 0) {
+            return &route;
+        }
+    }
+    return nullptr;
+}
+
+static uint8_t parseMethod(const char *method) {
+    static const struct {
+        const char *name;
+        uint8_t value;
+    } METHODS[] = {{"GET", HTTP_GET},     {"POST", HTTP_POST}, {"DELETE", HTTP_DELETE},  {"PUT", HTTP_PUT},
+                   {"PATCH", HTTP_PATCH}, {"HEAD", HTTP_HEAD}, {"OPTIONS", HTTP_OPTIONS}};
+    for (size_t i = 0; i < sizeof(METHODS) / sizeof(METHODS[0]); i++) {
+        if (strcasecmp(method, METHODS[i].name) == 0) {
+            return METHODS[i].value;
+        }
+    }
+    return 0;
+}
+
+AsyncWebServerRequest *hostHttpOpen(const char *method, const char *url, const char *body, const char *contentType,
+                                    uint32_t clientIp, const char *const *headers) {
+    if (!listening) {
+        return nullptr;
+    }
+    AsyncWebServerRequest *request = new AsyncWebServerRequest(parseMethod(method), url, clientIp);
+    for (size_t i = 0; headers && headers[i]; i++) {
+        const char *colon = strchr(headers[i], ':');
+        if (colon) {
+            const char *value = colon + 1;
+            while (*value == ' ') {
+                value++;
+            }
+            request->headerList.push_back(std::make_pair(std::string(headers[i], colon), std::string(value)));
+        }
+    }
+
+    const AsyncWebServer::Route *route = listening->match(*request);
+    if (!route) {
+        request->send(404);
+        return request;
+    }
+
+    const size_t total = body ? strlen(body) : 0;
+    const bool formEncoded = contentType && (strncasecmp(contentType, "application/x-www-form-urlencoded", 33) == 0 ||
+                                             strncasecmp(contentType, "text/plain", 10) == 0);
+    if (total > 0 && formEncoded) {
+        request->addParams(body, true);
+    } else if (total > 0 && route->onBody) {
+        std::vector<uint8_t> copy(body, body + total);
+        for (size_t index = 0; index < total; index += HOST_HTTP_SEGMENT) {
+            route->onBody(request, copy.data() + index, std::min(HOST_HTTP_SEGMENT, total - index), index, total);
+        }
+    }
+    route->onRequest(request);
+    return request;
+}
+
+const AsyncWebServerResponse *hostHttpResponse(const AsyncWebServerRequest *request) { return request->response; }
+
+void hostHttpClose(AsyncWebServerRequest *request) {
+    if (request->disconnectHandler) {
+        request->disconnectHandler();
+    }
+    delete request;
+}
+
+// --- MQTT loopback broker -------------------------------------------------
+
+static std::vector<AsyncMqttClient *> &mqttClients() {
+    static std::vector<AsyncMqttClient *> clients;
+    return clients;
+}
+
+AsyncMqttClient::AsyncMqttClient() { mqttClients().push_back(this); }
+
+AsyncMqttClient::~AsyncMqttClient() {
+    std::vector<AsyncMqttClient *> &clients = mqttClients();
+    clients.erase(std::remove(clients.begin(), clients.end(), this), clients.end());
+}
+
+void AsyncMqttClient::connect() {
+    if (isConnected || server.empty()) {
+        return;
+    }
+    isConnected = true;
+    if (connectCallback) {
+        connectCallback(false);
+    }
+}
+
+void AsyncMqttClient::disconnect(bool) {
+    if (!isConnected) {
+        return;
+    }
+    isConnected = false;
+    subscriptions.clear();
+    if (disconnectCallback) {
+        disconnectCallback(AsyncMqttClientDisconnectReason::TCP_DISCONNECTED);
+    }
+}
+
+uint16_t AsyncMqttClient::publish(const char *topic, uint8_t, bool retain, const char *payload, size_t length, bool,
+                                  uint16_t) {
+    if (!isConnected) {
+        return 0;
+    }
+    if (retain) {
+        retained[topic] = payload ? std::string(payload, length ? length : strlen(payload)) : std::string();
+    }
+    publishCount++;
+    return 1;
+}
+
+uint16_t AsyncMqttClient::subscribe(const char *topic, uint8_t) {
+    if (!isConnected) {
+        return 0;
+    }
+    subscriptions.push_back(topic);
+    return 1;
+}
+
+// MQTT topic filter match with + and # wildcards.
+static bool topicMatches(const std::string &filter, const std::string &topic) {
+    size_t f = 0, t = 0;
+    while (f < filter.size()) {
+        if (filter[f] == '#') {
+            return true;
+        }
+        const size_t fEnd = filter.find('/', f) == std::string::npos ? filter.size() : filter.find('/', f);
+        const size_t tEnd = topic.find('/', t) == std::string::npos ? topic.size() : topic.find('/', t);
+        if (t > topic.size() || (filter.compare(f, fEnd - f, "+") != 0 &&
+                                 filter.compare(f, fEnd - f, topic, t, tEnd - t) != 0)) {
+            return false;
+        }
+        f = fEnd + 1;
+        t = tEnd + 1;
+    }
+    return t > topic.size();
+}
+
+bool AsyncMqttClient::hostDeliver(const char *topic, const char *payload) {
+    if (!isConnected || !messageCallback) {
+        return false;
+    }
+    for (size_t i = 0; i < subscriptions.size(); i++) {
+        if (topicMatches(subscriptions[i], topic)) {
+            std::vector<char> topicCopy(topic, topic + strlen(topic) + 1);
+            std::vector<char> payloadCopy(payload, payload + strlen(payload) + 1);
+            const size_t len = strlen(payload);
+            AsyncMqttClientMessageProperties properties = {0, false, false};
+            messageCallback(topicCopy.data(), payloadCopy.data(), properties, len, 0, len);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool hostMqttDeliver(const char *topic, const char *payload) {
+    bool delivered = false;
+    for (size_t i = 0; i < mqttClients().size(); i++) {
+        delivered = mqttClients()[i]->hostDeliver(topic, payload) || delivered;
+    }
+    return delivered;
+}
+
+const AsyncMqttClient *hostMqttClient() { return mqttClients().empty() ? nullptr : mqttClients().front(); }
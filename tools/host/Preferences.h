@@ -0,0 +1,60 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+// In-memory NVS stand-in. All instances share one store, like the real
+// partition, and it lives for the lifetime of the host process.
+class Preferences {
+public:
+    bool begin(const char *name, bool readOnly = false);
+    void end() {}
+
+    bool getBool(const char *key, bool defaultValue = false) { return getValue<bool>(key, defaultValue); }
+    size_t putBool(const char *key, bool value) { return putValue(key, value); }
+    uint8_t getUChar(const char *key, uint8_t defaultValue = 0) { return getValue<uint8_t>(key, defaultValue); }
+    size_t putUChar(const char *key, uint8_t value) { return putValue(key, value); }
+    int16_t getShort(const char *key, int16_t defaultValue = 0) { return getValue<int16_t>(key, defaultValue); }
+    size_t putShort(const char *key, int16_t value) { return putValue(key, value); }
+    uint16_t getUShort(const char *key, uint16_t defaultValue = 0) { return getValue<uint16_t>(key, defaultValue); }
+    size_t putUShort(const char *key, uint16_t value) { return putValue(key, value); }
+    uint32_t getULong(const char *key, uint32_t defaultValue = 0) { return getValue<uint32_t>(key, defaultValue); }
+    size_t putULong(const char *key, uint32_t value) { return putValue(key, value); }
+
+    // Copies the string and its terminator; 0 if missing or too long.
+    size_t getString(const char *key, char *value, size_t maxLen);
+    size_t putString(const char *key, const char *value);
+
+    size_t getBytesLength(const char *key);
+    size_t getBytes(const char *key, void *buf, size_t maxLen);
+    size_t putBytes(const char *key, const void *value, size_t len);
+
+    // Wipes every namespace (e.g. between simulator runs).
+    static void hostReset();
+
+private:
+    std::string space;
+
+    std::vector<uint8_t> *find(const char *key);
+
+    template <typename T>
+    T getValue(const char *key, T defaultValue) {
+        T value = defaultValue;
+        std::vector<uint8_t> *stored = find(key);
+        if (stored && stored->size() == sizeof(T)) {
+            value = *reinterpret_cast<const T *>(stored->data());
+        }
+        return value;
+    }
+
+    template <typename T>
+    size_t putValue(const char *key, T value) {
+        return putBytes(key, &value, sizeof(T));
+    }
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef HOST_UPDATE_H
+#define HOST_UPDATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Memory-backed stand-in for the OTA slot. The slot is absent by default,
+// so /api/ota answers "no OTA partition" in the simulator; host tests call
+// hostSetPartition(true) and read back what was written.
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define U_FLASH 0
+
+class UpdateClass {
+public:
+    bool begin(size_t, int) {
+        image.clear();
+        open = hasPartition;
+        return open;
+    }
+    size_t write(uint8_t *data, size_t len) {
+        if (!open || image.size() + len > failAfter) {
+            return 0;
+        }
+        image.insert(image.end(), data, data + len);
+        return len;
+    }
+    bool end(bool) {
+        const bool ok = open;
+        open = false;
+        ended = ok;
+        return ok;
+    }
+    void abort() { open = false; }
+
+    // host-only
+    void hostSetPartition(bool present) { hasPartition = present; }
+    // Writes fail once the slot would hold more than `bytes`.
+    void hostFailAfter(size_t bytes) { failAfter = bytes; }
+    const std::vector<uint8_t> &hostImage() const { return image; }
+    bool hostEnded() const { return ended; }
+
+private:
+    bool hasPartition = false;
+    bool open = false;
+    bool ended = false;
+    size_t failAfter = SIZE_MAX;
+    std::vector<uint8_t> image;
+};
+
+extern UpdateClass Update;
+
+#endif
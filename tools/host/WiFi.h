@@ -0,0 +1,81 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+#include <functional>
+
+// Station that joins at once (or never, see hostWiFiSetJoinable()) with the
+// static IP the firmware asks for.
+
+class IPAddress {
+public:
+    IPAddress() : bytes{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : bytes{a, b, c, d} {}
+    explicit IPAddress(uint32_t address) {
+        for (int i = 0; i < 4; i++) {
+            bytes[i] = static_cast<uint8_t>(address >> (8 * i));
+        }
+    }
+
+    uint8_t operator[](int index) const { return bytes[index]; }
+    bool operator==(const IPAddress &other) const { return memcmp(bytes, other.bytes, 4) == 0; }
+    operator uint32_t() const {
+        return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24);
+    }
+    String toString() const {
+        char text[16];
+        snprintf(text, sizeof(text), "%u.%u.%u.%u", bytes[0], bytes[1], bytes[2], bytes[3]);
+        return String(text);
+    }
+
+private:
+    uint8_t bytes[4];
+};
+
+typedef enum { WIFI_OFF, WIFI_STA, WIFI_AP, WIFI_AP_STA } wifi_mode_t;
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+typedef enum { WIFI_POWER_19_5dBm = 78, WIFI_POWER_8_5dBm = 34 } wifi_power_t;
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_CONNECT_FAILED = 4, WL_DISCONNECTED = 6 } wl_status_t;
+typedef int WiFiEvent_t;
+typedef struct {
+    int unused;
+} WiFiEventInfo_t;
+typedef std::function<void(WiFiEvent_t, WiFiEventInfo_t)> WiFiEventFuncCb;
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t next);
+    wifi_mode_t getMode() const { return wifiMode; }
+    bool setSleep(bool enabled) { return setSleep(enabled ? WIFI_PS_MIN_MODEM : WIFI_PS_NONE); }
+    bool setSleep(wifi_ps_type_t type);
+    wifi_ps_type_t getSleep() const { return sleepType; }
+    bool setTxPower(wifi_power_t) { return true; }
+    bool config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(),
+                IPAddress dns2 = IPAddress());
+    wl_status_t begin(const char *ssid, const char *password);
+    wl_status_t status() const { return joined ? WL_CONNECTED : WL_DISCONNECTED; }
+    bool isConnected() const { return joined; }
+    bool disconnect(bool wifiOff = false);
+    IPAddress localIP() const { return joined ? staticIp : IPAddress(); }
+    int8_t RSSI() const { return joined ? -55 : 0; }
+    uint8_t *macAddress(uint8_t *mac) const;
+    bool softAP(const char *ssid, const char *password);
+    bool softAPdisconnect(bool wifiOff = false);
+    IPAddress softAPIP() const { return apUp ? IPAddress(192, 168, 4, 1) : IPAddress(); }
+    void onEvent(WiFiEventFuncCb callback) { (void)callback; }
+
+    // host-only: whether begin() finds the network (default true)
+    void hostSetJoinable(bool value) { joinable = value; }
+
+private:
+    wifi_mode_t wifiMode = WIFI_OFF;
+    wifi_ps_type_t sleepType = WIFI_PS_MIN_MODEM;
+    IPAddress staticIp = IPAddress(192, 168, 1, 80);
+    bool joinable = true;
+    bool joined = false;
+    bool apUp = false;
+};
+
+extern WiFiClass WiFi;
+
+#endif
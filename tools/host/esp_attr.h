@@ -0,0 +1,8 @@
+#ifndef HOST_ESP_ATTR_H
+#define HOST_ESP_ATTR_H
+
+// Host memory is plain RAM: RTC_NOINIT data starts zeroed every run.
+#define RTC_NOINIT_ATTR
+#define IRAM_ATTR
+
+#endif
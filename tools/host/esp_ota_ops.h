@@ -0,0 +1,16 @@
+#ifndef HOST_ESP_OTA_OPS_H
+#define HOST_ESP_OTA_OPS_H
+
+#include "esp_err.h"
+
+// No partition table on the host: there is never a slot to roll back to.
+
+typedef struct {
+    char label[17];
+} esp_partition_t;
+
+inline const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *) { return nullptr; }
+inline esp_err_t esp_ota_set_boot_partition(const esp_partition_t *) { return ESP_FAIL; }
+inline esp_err_t esp_ota_mark_app_valid_cancel_rollback() { return ESP_OK; }
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef HOST_MBEDTLS_MD_H
+#define HOST_MBEDTLS_MD_H
+
+#include "sha256.h"
+
+// HMAC-SHA256 only (RFC 2104), through the generic mbedtls_md_hmac() call.
+
+typedef enum {
+    MBEDTLS_MD_NONE = 0,
+    MBEDTLS_MD_SHA256 = 6,
+} mbedtls_md_type_t;
+
+typedef struct {
+    mbedtls_md_type_t type;
+} mbedtls_md_info_t;
+
+inline const mbedtls_md_info_t *mbedtls_md_info_from_type(mbedtls_md_type_t type) {
+    static const mbedtls_md_info_t SHA256_INFO = {MBEDTLS_MD_SHA256};
+    return type == MBEDTLS_MD_SHA256 ? &SHA256_INFO : nullptr;
+}
+
+inline int mbedtls_md_hmac(const mbedtls_md_info_t *info, const unsigned char *key, size_t keyLen,
+                           const unsigned char *input, size_t len, unsigned char *output) {
+    if (info == nullptr || info->type != MBEDTLS_MD_SHA256) {
+        return -1;
+    }
+    uint8_t block[64] = {};
+    mbedtls_sha256_context ctx;
+    if (keyLen > sizeof(block)) {
+        mbedtls_sha256_init(&ctx);
+        mbedtls_sha256_starts_ret(&ctx, 0);
+        mbedtls_sha256_update_ret(&ctx, key, keyLen);
+        mbedtls_sha256_finish_ret(&ctx, block);
+    } else if (keyLen > 0) {
+        memcpy(block, key, keyLen);
+    }
+
+    uint8_t pad[64];
+    uint8_t inner[32];
+    for (size_t i = 0; i < sizeof(pad); i++) {
+        pad[i] = block[i] ^ 0x36;
+    }
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts_ret(&ctx, 0);
+    mbedtls_sha256_update_ret(&ctx, pad, sizeof(pad));
+    mbedtls_sha256_update_ret(&ctx, input, len);
+    mbedtls_sha256_finish_ret(&ctx, inner);
+
+    for (size_t i = 0; i < sizeof(pad); i++) {
+        pad[i] = block[i] ^ 0x5c;
+    }
+    mbedtls_sha256_starts_ret(&ctx, 0);
+    mbedtls_sha256_update_ret(&ctx, pad, sizeof(pad));
+    mbedtls_sha256_update_ret(&ctx, inner, sizeof(inner));
+    mbedtls_sha256_finish_ret(&ctx, output);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,742 @@
+// Runs the real firmware - setup() and loop() from src/main.cpp with the
+// web routes, MQTT bridge, scheduler and power governor - on the host under
+// a virtual clock, driven by a scenario of web requests and MQTT messages.
+// Hours of lamp time take seconds. Along the way it checks
+//   - frame timing: the interval between party-mode render ticks,
+//   - party hue drift: the float hue accumulator against a double-precision
+//     integration of the same ticks,
+//   - the power limit: no channel above 30% (locked) or 60% (unlocked),
+//     at the moment it is written or at any later point,
+// and can export the PWM timeline of every channel as CSV or VCD, or every
+// trace record as a file for tools/build/trace_replay.
+//
+//   make -C tools lamp_sim
+//   tools/build/lamp_sim tools/lamp_sim/soak.scenario [--csv out.csv] [--vcd out.vcd] [--trace out.trace]
+//
+// Web requests run between loop() passes, while the loop task sleeps in
+// delay() or its idle wait, much as the async_tcp task preempts it on the
+// lamp. Background tasks (the stall monitor) do not run.
+
+#include <Arduino.h>
+#include <AsyncMqttClient.h>
+#include <ESPAsyncWebServer.h>
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <string>
+#include <vector>
+#include "LEDController.h"
+#include "PartyRenderer.h"
+#include "PowerGovernor.h"
+#include "State.h"
+#include "Trace.h"
+
+void setup();
+void loop();
+
+// Firmware globals from src/main.cpp.
+extern LampLEDController ledController;
+extern StateHandler stateHandler;
+extern PartyRenderer partyRenderer;
+extern OperationMode lastMode; // mode seen by the previous render tick
+
+static constexpr float LOCKED_LIMIT = 0.30f;
+static constexpr float UNLOCKED_LIMIT = 0.60f;
+static constexpr size_t MAX_LEDC_CHANNELS = 8;
+
+// --- scenario ---------------------------------------------------------------
+
+enum class EventKind : uint8_t { REQUEST, CLOSE, MQTT, HEAP, END };
+
+struct ScenarioLine {
+    int lineNumber;
+    uint64_t atUs;
+    EventKind kind;
+    std::string method;
+    std::string url;
+    std::string body;  // request body, MQTT payload
+    uint32_t repeat;
+    uint64_t everyUs;
+    uint32_t clients;
+    uint64_t holdUs;
+    uint32_t heapBytes;
+};
+
+struct Event {
+    uint64_t atUs;
+    uint64_t order; // keeps events at the same time in scenario order
+    EventKind kind;
+    const ScenarioLine *line;
+    uint32_t index;                  // repetition number
+    AsyncWebServerRequest *request;  // CLOSE
+
+    bool operator>(const Event &other) const {
+        return atUs != other.atUs ? atUs > other.atUs : order > other.order;
+    }
+};
+
+static bool parseDuration(const std::string &text, uint64_t &outUs) {
+    char *end = nullptr;
+    const double value = strtod(text.c_str(), &end);
+    if (end == text.c_str() || value < 0) {
+        return false;
+    }
+    const std::string unit(end);
+    double scale;
+    if (unit.empty() || unit == "s") {
+        scale = 1e6;
+    } else if (unit == "ms") {
+        scale = 1e3;
+    } else if (unit == "us") {
+        scale = 1;
+    } else if (unit == "m") {
+        scale = 60e6;
+    } else if (unit == "h") {
+        scale = 3600e6;
+    } else {
+        return false;
+    }
+    outUs = static_cast<uint64_t>(value * scale + 0.5);
+    return true;
+}
+
+static std::vector<std::string> splitWords(const std::string &line, size_t maxWords) {
+    std::vector<std::string> words;
+    size_t pos = 0;
+    while (pos < line.size()) {
+        pos = line.find_first_not_of(" \t\r\n", pos);
+        if (pos == std::string::npos) {
+            break;
+        }
+        if (words.size() + 1 == maxWords) {
+            size_t end = line.find_last_not_of(" \t\r\n");
+            words.push_back(line.substr(pos, end + 1 - pos));
+            break;
+        }
+        size_t end = line.find_first_of(" \t\r\n", pos);
+        if (end == std::string::npos) {
+            end = line.size();
+        }
+        words.push_back(line.substr(pos, end - pos));
+        pos = end;
+    }
+    return words;
+}
+
+// <time> [repeat=N every=T] [clients=N] [hold=T] GET|POST <url> [body]
+// <time> mqtt <topic below colorshadow/<id>/> <payload>
+// <time> heap <free bytes>
+// <time> end
+static bool parseScenario(const char *path, std::vector<ScenarioLine> &lines) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    char buffer[1024];
+    int number = 0;
+    bool ok = true;
+    while (ok && fgets(buffer, sizeof(buffer), file)) {
+        number++;
+        std::string text(buffer);
+        const size_t hash = text.find('#');
+        if (hash != std::string::npos) {
+            text.erase(hash);
+        }
+        std::vector<std::string> head = splitWords(text, 2);
+        if (head.empty()) {
+            continue;
+        }
+
+        ScenarioLine line = {};
+        line.lineNumber = number;
+        line.repeat = 1;
+        line.clients = 1;
+        ok = head.size() == 2 && parseDuration(head[0], line.atUs);
+        std::string rest = ok ? head[1] : "";
+        while (ok) {
+            std::vector<std::string> parts = splitWords(rest, 2);
+            const std::string word = parts.empty() ? "" : parts[0];
+            const size_t eq = word.find('=');
+            if (eq == std::string::npos) {
+                break;
+            }
+            const std::string key = word.substr(0, eq), value = word.substr(eq + 1);
+            if (key == "repeat") {
+                line.repeat = static_cast<uint32_t>(strtoul(value.c_str(), nullptr, 10));
+                ok = line.repeat > 0;
+            } else if (key == "every") {
+                ok = parseDuration(value, line.everyUs);
+            } else if (key == "clients") {
+                line.clients = static_cast<uint32_t>(strtoul(value.c_str(), nullptr, 10));
+                ok = line.clients > 0 && line.clients < 250;
+            } else if (key == "hold") {
+                ok = parseDuration(value, line.holdUs);
+            } else {
+                ok = false;
+            }
+            rest = parts.size() > 1 ? parts[1] : "";
+        }
+
+        std::vector<std::string> words = splitWords(rest, 3);
+        if (ok && !words.empty()) {
+            const std::string &verb = words[0];
+            if (verb == "GET" || verb == "POST") {
+                line.kind = EventKind::REQUEST;
+                line.method = verb;
+                ok = words.size() >= 2;
+                line.url = ok ? words[1] : "";
+                line.body = words.size() > 2 ? words[2] : "";
+            } else if (verb == "mqtt") {
+                line.kind = EventKind::MQTT;
+                ok = words.size() == 3;
+                line.url = ok ? words[1] : "";
+                line.body = ok ? words[2] : "";
+            } else if (verb == "heap") {
+                line.kind = EventKind::HEAP;
+                ok = words.size() == 2;
+                line.heapBytes = ok ? static_cast<uint32_t>(strtoul(words[1].c_str(), nullptr, 10)) : 0;
+            } else if (verb == "end") {
+                line.kind = EventKind::END;
+            } else {
+                ok = false;
+            }
+        } else {
+            ok = false;
+        }
+        if (ok) {
+            lines.push_back(line);
+        } else {
+            fprintf(stderr, "%s:%d: cannot parse: %s", path, number, buffer);
+        }
+    }
+    fclose(file);
+    return ok;
+}
+
+// --- simulation state --------------------------------------------------------
+
+static std::priority_queue<Event, std::vector<Event>, std::greater<Event> > events;
+static uint64_t eventOrder = 0;
+static bool endReached = false;
+static uint32_t randomState = 1;
+static bool printReplies = true;
+
+static std::map<int, uint32_t> statusCounts;
+static uint32_t refused = 0;
+static uint32_t mqttDelivered = 0;
+static uint32_t mqttIgnored = 0;
+
+static void schedule(uint64_t atUs, EventKind kind, const ScenarioLine *line, uint32_t index,
+                     AsyncWebServerRequest *request = nullptr) {
+    Event event = {atUs, eventOrder++, kind, line, index, request};
+    events.push(event);
+}
+
+static uint32_t nextRandom() {
+    randomState = randomState * 1103515245u + 12345u;
+    return (randomState >> 16) & 0x7FFF;
+}
+
+// {i} = repetition number, {r} = a fresh pseudo-random 0-255 (--seed).
+static std::string expand(const std::string &text, uint32_t index) {
+    std::string out;
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text.compare(i, 3, "{i}") == 0) {
+            out += std::to_string(index);
+            i += 2;
+        } else if (text.compare(i, 3, "{r}") == 0) {
+            out += std::to_string(nextRandom() % 256);
+            i += 2;
+        } else {
+            out += text[i];
+        }
+    }
+    return out;
+}
+
+static void runRequest(const ScenarioLine &line, uint32_t index) {
+    const std::string url = expand(line.url, index);
+    const std::string body = expand(line.body, index);
+    const uint32_t clientIp = static_cast<uint32_t>(IPAddress(192, 168, 1, 100 + index % line.clients));
+    AsyncWebServerRequest *request =
+        hostHttpOpen(line.method.c_str(), url.c_str(), body.empty() ? nullptr : body.c_str(),
+                     "application/octet-stream", clientIp);
+    if (!request) {
+        refused++;
+        return;
+    }
+    const AsyncWebServerResponse *response = hostHttpResponse(request);
+    statusCounts[response ? response->code : 0]++;
+    if (printReplies && line.repeat == 1) {
+        printf("[%10.3f s] %s %s -> %d %s\n", hostMicros() / 1e6, line.method.c_str(), url.c_str(),
+               response ? response->code : 0,
+               response && response->contentType == "application/json" ? response->content.c_str() : "");
+    }
+    if (line.holdUs == 0) {
+        hostHttpClose(request);
+    } else {
+        schedule(hostMicros() + line.holdUs, EventKind::CLOSE, &line, index, request);
+    }
+}
+
+static void runEvent(const Event &event) {
+    switch (event.kind) {
+    case EventKind::REQUEST:
+        runRequest(*event.line, event.index);
+        break;
+    case EventKind::CLOSE:
+        hostHttpClose(event.request);
+        break;
+    case EventKind::MQTT: {
+        uint8_t mac[6];
+        WiFi.macAddress(mac);
+        char topic[128];
+        snprintf(topic, sizeof(topic), "colorshadow/cs_%02x%02x%02x/%s", mac[3], mac[4], mac[5],
+                 event.line->url.c_str());
+        const std::string payload = expand(event.line->body, event.index);
+        if (hostMqttDeliver(topic, payload.c_str())) {
+            mqttDelivered++;
+        } else {
+            mqttIgnored++;
+        }
+        break;
+    }
+    case EventKind::HEAP:
+        hostSetFreeHeap(event.line->heapBytes);
+        break;
+    case EventKind::END:
+        endReached = true;
+        break;
+    }
+    // A repeated line schedules its next repetition when the current one runs.
+    if (event.kind != EventKind::CLOSE && event.index + 1 < event.line->repeat) {
+        schedule(event.atUs + event.line->everyUs, event.line->kind, event.line, event.index + 1);
+    }
+}
+
+// Idle hook: the loop task is blocked, so whatever is due runs now.
+static void runDueEvents(uint64_t untilUs) {
+    if (!events.empty() && events.top().atUs <= untilUs && !endReached) {
+        const Event event = events.top();
+        events.pop();
+        if (event.atUs > hostMicros()) {
+            hostSetMicros(event.atUs);
+        }
+        runEvent(event);
+        return;
+    }
+    hostSetMicros(untilUs);
+}
+
+// --- checks --------------------------------------------------------------
+
+struct TimelinePoint {
+    uint64_t timeUs;
+    uint8_t channel; // LEDC channel, or MODE_COLUMN
+    uint16_t value;
+};
+
+static constexpr uint8_t MODE_COLUMN = 0xFF;
+
+static std::vector<TimelinePoint> timeline;
+static bool recordTimeline = false;
+static std::vector<TraceRecord> traceLog; // unbounded, unlike the lamp's ring
+static bool recordTrace = false;
+static bool channelSeen[MAX_LEDC_CHANNELS] = {};
+static int channelDuty[MAX_LEDC_CHANNELS] = {};
+
+static uint64_t maxFrameUs = 25000;
+static uint64_t lastTickMs = 0;
+static bool haveTick = false;
+static uint64_t ticks = 0;
+static uint64_t tickIntervals = 0;
+static uint64_t tickIntervalSumMs = 0;
+static uint64_t worstTickMs = 0;
+static uint64_t lateTicks = 0;
+static std::map<uint64_t, uint64_t> tickHistogram;
+
+static double maxDriftDeg = 0.5;
+static double referenceHue = 0.0;
+static uint64_t referenceLastMs = 0;
+static bool tickThisPass = false;
+static double worstDrift = 0.0;
+static uint64_t worstDriftAtUs = 0;
+
+static uint64_t pwmWrites = 0;
+static uint64_t writesOverLimit = 0;
+static bool overLimit = false;
+static uint64_t overLimitSinceUs = 0;
+static uint64_t overLimitEpisodes = 0;
+static uint64_t worstOverLimitUs = 0;
+
+static float currentLimit() { return ledController.isUnlocked() ? UNLOCKED_LIMIT : LOCKED_LIMIT; }
+
+static bool dutyAllowed(int duty, float limit) { return duty <= static_cast<int>(2047 * limit + 0.5f); }
+
+static void onTrace(const TraceRecord &record) {
+    if (recordTrace) {
+        traceLog.push_back(record);
+    }
+    switch (static_cast<TraceEvent>(record.event)) {
+    case TraceEvent::PWM:
+        if (record.code >= MAX_LEDC_CHANNELS) {
+            break;
+        }
+        pwmWrites++;
+        channelSeen[record.code] = true;
+        channelDuty[record.code] = static_cast<int>(record.value);
+        if (!dutyAllowed(channelDuty[record.code], currentLimit())) {
+            writesOverLimit++;
+        }
+        if (recordTimeline) {
+            TimelinePoint point = {hostMicros(), record.code, static_cast<uint16_t>(record.value)};
+            timeline.push_back(point);
+        }
+        break;
+
+    case TraceEvent::MODE:
+        if (recordTimeline) {
+            TimelinePoint point = {hostMicros(), MODE_COLUMN, record.code};
+            timeline.push_back(point);
+        }
+        break;
+
+    case TraceEvent::TICK: {
+        // main.cpp resets the renderer on the first render tick outside party
+        // mode, so a tick following a non-party tick starts from hue 0.
+        const uint64_t nowMs = record.value;
+        const bool continued = lastMode == OperationMode::PARTY;
+        if (!continued) {
+            referenceHue = 0.0;
+            referenceLastMs = 0;
+        }
+        const double dt = referenceLastMs == 0 ? 0.0 : (nowMs - referenceLastMs) / 1000.0;
+        referenceLastMs = nowMs;
+        referenceHue = fmod(referenceHue + dt * static_cast<double>(stateHandler.getPartyHz()) * 360.0, 360.0);
+        tickThisPass = true;
+
+        ticks++;
+        if (continued && haveTick) {
+            const uint64_t interval = nowMs - lastTickMs;
+            tickIntervals++;
+            tickIntervalSumMs += interval;
+            tickHistogram[interval]++;
+            worstTickMs = std::max(worstTickMs, interval);
+            if (interval * 1000 > maxFrameUs) {
+                lateTicks++;
+            }
+        }
+        lastTickMs = nowMs;
+        haveTick = true;
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+// After each loop() pass: compare the renderer's hue once it has stepped,
+// and watch for outputs left above a limit that has since dropped.
+static void checkPass() {
+    if (tickThisPass) {
+        tickThisPass = false;
+        double diff = fabs(fmod(static_cast<double>(partyRenderer.getHue()), 360.0) - referenceHue);
+        diff = std::min(diff, 360.0 - diff);
+        if (diff > worstDrift) {
+            worstDrift = diff;
+            worstDriftAtUs = hostMicros();
+        }
+    }
+
+    const float limit = currentLimit();
+    bool over = false;
+    for (size_t i = 0; i < MAX_LEDC_CHANNELS; i++) {
+        over = over || (channelSeen[i] && !dutyAllowed(channelDuty[i], limit));
+    }
+    if (over && !overLimit) {
+        overLimitSinceUs = hostMicros();
+        overLimitEpisodes++;
+    } else if (!over && overLimit) {
+        worstOverLimitUs = std::max(worstOverLimitUs, hostMicros() - overLimitSinceUs);
+    }
+    overLimit = over;
+}
+
+// --- export --------------------------------------------------------------
+
+static std::vector<uint8_t> exportedChannels() {
+    std::vector<uint8_t> channels;
+    for (size_t i = 0; i < MAX_LEDC_CHANNELS; i++) {
+        if (channelSeen[i]) {
+            channels.push_back(static_cast<uint8_t>(i));
+        }
+    }
+    return channels;
+}
+
+// One row per instant at which anything changed; values are the logical
+// duty (0-2047, after trim and power limit) as LEDController writes it.
+static bool writeCsv(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    const std::vector<uint8_t> channels = exportedChannels();
+    fprintf(file, "time_us,mode");
+    for (size_t i = 0; i < channels.size(); i++) {
+        fprintf(file, ",ledc%u", channels[i]);
+    }
+    fprintf(file, "\n");
+
+    int values[MAX_LEDC_CHANNELS] = {};
+    int mode = static_cast<int>(OperationMode::WIFI);
+    for (size_t i = 0; i < timeline.size(); i++) {
+        const TimelinePoint &point = timeline[i];
+        if (point.channel == MODE_COLUMN) {
+            mode = point.value;
+        } else {
+            values[point.channel] = point.value;
+        }
+        if (i + 1 < timeline.size() && timeline[i + 1].timeUs == point.timeUs) {
+            continue;
+        }
+        fprintf(file, "%llu,%s", static_cast<unsigned long long>(point.timeUs),
+                operationModeName(static_cast<OperationMode>(mode)));
+        for (size_t c = 0; c < channels.size(); c++) {
+            fprintf(file, ",%d", values[channels[c]]);
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+    return true;
+}
+
+static void writeVcdBits(FILE *file, unsigned value, int bits, char id) {
+    fputc('b', file);
+    for (int bit = bits - 1; bit >= 0; bit--) {
+        fputc((value >> bit) & 1 ? '1' : '0', file);
+    }
+    fprintf(file, " %c\n", id);
+}
+
+static bool writeVcd(const char *path) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    const std::vector<uint8_t> channels = exportedChannels();
+    fprintf(file, "$comment colorshadow lamp_sim: logical duty 0-2047 per LEDC channel $end\n");
+    fprintf(file, "$timescale 1us $end\n$scope module lamp $end\n");
+    fprintf(file, "$var wire 2 m mode $end\n");
+    for (size_t i = 0; i < channels.size(); i++) {
+        fprintf(file, "$var wire 11 %c ledc%u $end\n", static_cast<char>('a' + channels[i]), channels[i]);
+    }
+    fprintf(file, "$upscope $end\n$enddefinitions $end\n#0\n$dumpvars\n");
+    writeVcdBits(file, static_cast<unsigned>(OperationMode::WIFI), 2, 'm');
+    for (size_t i = 0; i < channels.size(); i++) {
+        writeVcdBits(file, 0, 11, static_cast<char>('a' + channels[i]));
+    }
+    fprintf(file, "$end\n");
+
+    uint64_t lastTime = 0;
+    for (size_t i = 0; i < timeline.size(); i++) {
+        const TimelinePoint &point = timeline[i];
+        if (point.timeUs != lastTime) {
+            fprintf(file, "#%llu\n", static_cast<unsigned long long>(point.timeUs));
+            lastTime = point.timeUs;
+        }
+        if (point.channel == MODE_COLUMN) {
+            writeVcdBits(file, point.value, 2, 'm');
+        } else {
+            writeVcdBits(file, point.value, 11, static_cast<char>('a' + point.channel));
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+// Same layout as /api/trace, with nothing lost to wrap-around.
+static bool writeTrace(const char *path) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    TraceFileHeader header = {{'C', 'S', 'L', 'T'}, TraceRecorder::VERSION, sizeof(TraceRecord),
+                              static_cast<uint32_t>(traceLog.size()), 0};
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              (traceLog.empty() ||
+               fwrite(traceLog.data(), sizeof(TraceRecord), traceLog.size(), file) == traceLog.size());
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        perror(path);
+    }
+    return ok;
+}
+
+// --- main ----------------------------------------------------------------
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "usage: %s <scenario> [--duration T] [--csv FILE] [--vcd FILE] [--trace FILE] [--loop-cost T]\n"
+            "          [--max-frame T] [--max-drift DEG] [--seed N] [--quiet] [--verbose]\n"
+            "times take us/ms/s/m/h suffixes (default seconds)\n",
+            name);
+}
+
+static void printJson(const char *method, const char *url) {
+    AsyncWebServerRequest *request = hostHttpOpen(method, url, nullptr, nullptr, 0x0101a8c0);
+    const AsyncWebServerResponse *response = request ? hostHttpResponse(request) : nullptr;
+    printf("%s: %s\n", url, response ? response->content.c_str() : "(no reply)");
+    if (request) {
+        hostHttpClose(request);
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *scenarioPath = nullptr;
+    const char *csvPath = nullptr;
+    const char *vcdPath = nullptr;
+    const char *tracePath = nullptr;
+    uint64_t durationUs = 0;
+    uint64_t loopCostUs = 0;
+    bool verbose = false;
+    bool ok = true;
+    for (int i = 1; i < argc && ok; i++) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--duration" && hasValue) {
+            ok = parseDuration(argv[++i], durationUs);
+        } else if (arg == "--csv" && hasValue) {
+            csvPath = argv[++i];
+        } else if (arg == "--vcd" && hasValue) {
+            vcdPath = argv[++i];
+        } else if (arg == "--trace" && hasValue) {
+            tracePath = argv[++i];
+        } else if (arg == "--loop-cost" && hasValue) {
+            ok = parseDuration(argv[++i], loopCostUs);
+        } else if (arg == "--max-frame" && hasValue) {
+            ok = parseDuration(argv[++i], maxFrameUs);
+        } else if (arg == "--max-drift" && hasValue) {
+            maxDriftDeg = atof(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            randomState = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--quiet") {
+            printReplies = false;
+        } else if (arg == "--verbose") {
+            verbose = true;
+        } else if (arg[0] != '-' && !scenarioPath) {
+            scenarioPath = argv[i];
+        } else {
+            ok = false;
+        }
+    }
+    if (!ok || !scenarioPath) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<ScenarioLine> lines;
+    if (!parseScenario(scenarioPath, lines)) {
+        return 2;
+    }
+    uint64_t scenarioEndUs = 0;
+    for (size_t i = 0; i < lines.size(); i++) {
+        schedule(lines[i].atUs, lines[i].kind, &lines[i], 0);
+        scenarioEndUs = std::max(scenarioEndUs, lines[i].atUs + lines[i].everyUs * (lines[i].repeat - 1));
+    }
+    if (durationUs == 0) {
+        durationUs = scenarioEndUs + 1000000;
+    }
+
+    hostSetSerialEnabled(verbose);
+    hostSetIdleHook(runDueEvents);
+    traceSetObserver(onTrace);
+    recordTimeline = csvPath || vcdPath;
+    recordTrace = tracePath != nullptr;
+
+    struct timespec wallStart, wallEnd;
+    clock_gettime(CLOCK_MONOTONIC, &wallStart);
+
+    setup();
+    uint64_t passes = 0;
+    while (!endReached && hostMicros() < durationUs) {
+        loop();
+        if (loopCostUs) {
+            hostIdle(hostMicros() + loopCostUs);
+        }
+        checkPass();
+        passes++;
+    }
+    if (overLimit) {
+        worstOverLimitUs = std::max(worstOverLimitUs, hostMicros() - overLimitSinceUs);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &wallEnd);
+    const double wallSeconds = (wallEnd.tv_sec - wallStart.tv_sec) + (wallEnd.tv_nsec - wallStart.tv_nsec) / 1e9;
+    const double simSeconds = hostMicros() / 1e6;
+
+    printf("\nsimulated %.1f s in %.2f s (%.0fx), %llu loop passes\n", simSeconds, wallSeconds,
+           wallSeconds > 0 ? simSeconds / wallSeconds : 0.0, static_cast<unsigned long long>(passes));
+
+    printf("http:");
+    for (std::map<int, uint32_t>::const_iterator it = statusCounts.begin(); it != statusCounts.end(); ++it) {
+        printf(" %d x%u", it->first, it->second);
+    }
+    printf("%s", statusCounts.empty() ? " none" : "");
+    if (refused) {
+        printf(", %u refused (server not up)", refused);
+    }
+    printf("\n");
+    if (mqttDelivered || mqttIgnored) {
+        const AsyncMqttClient *client = hostMqttClient();
+        printf("mqtt: %u delivered, %u not subscribed, %u published\n", mqttDelivered, mqttIgnored,
+               client ? client->hostPublishCount() : 0);
+    }
+
+    bool pass = true;
+    printf("frames: %llu party ticks", static_cast<unsigned long long>(ticks));
+    if (tickIntervals) {
+        printf(", interval mean %.2f ms, max %llu ms, %llu over %.1f ms", tickIntervalSumMs / double(tickIntervals),
+               static_cast<unsigned long long>(worstTickMs), static_cast<unsigned long long>(lateTicks),
+               maxFrameUs / 1000.0);
+        printf(" [");
+        for (std::map<uint64_t, uint64_t>::const_iterator it = tickHistogram.begin(); it != tickHistogram.end();
+             ++it) {
+            printf("%s%llums:%llu", it == tickHistogram.begin() ? "" : " ", static_cast<unsigned long long>(it->first),
+                   static_cast<unsigned long long>(it->second));
+        }
+        printf("]");
+    }
+    printf("%s\n", lateTicks ? "  FAIL" : "");
+    pass = pass && lateTicks == 0;
+
+    printf("party hue: worst drift %.6f deg at %.1f s (limit %.3f)%s\n", worstDrift, worstDriftAtUs / 1e6,
+           maxDriftDeg, worstDrift > maxDriftDeg ? "  FAIL" : "");
+    pass = pass && worstDrift <= maxDriftDeg;
+
+    printf("power limit: %llu writes, %llu over the limit when written, %llu episodes above it later "
+           "(worst %.1f ms)%s\n",
+           static_cast<unsigned long long>(pwmWrites), static_cast<unsigned long long>(writesOverLimit),
+           static_cast<unsigned long long>(overLimitEpisodes), worstOverLimitUs / 1000.0,
+           writesOverLimit || overLimitEpisodes ? "  FAIL" : "");
+    pass = pass && writesOverLimit == 0 && overLimitEpisodes == 0;
+
+    printJson("GET", "/api/power");
+    printJson("GET", "/api/admission");
+
+    if (csvPath && writeCsv(csvPath)) {
+        printf("wrote %s\n", csvPath);
+    }
+    if (vcdPath && writeVcd(vcdPath)) {
+        printf("wrote %s\n", vcdPath);
+    }
+    if (tracePath && writeTrace(tracePath)) {
+        printf("wrote %s\n", tracePath);
+    }
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,338 @@
+// Host test of the OTA path. Heatshrink output (w=10, l=5, the format
+// tools/ota_upload.py produces) is fed through the real HeatshrinkDecoder and
+// ChunkWriter into a memory sink in pieces of many sizes, then whole uploads
+// run through OtaUpdater against a memory OTA slot: good image, bad sha256,
+// truncated stream, bad signature, failing flash.
+//
+//   make -C tools ota_test && tools/build/ota_test
+//   tools/build/ota_test IMAGE IMAGE.hs   also checks a file compressed by
+//                                         tools/ota_upload.py --out
+
+#include <Arduino.h>
+#include <Update.h>
+#include <mbedtls/md.h>
+#include <algorithm>
+#include <vector>
+#include "OtaUpdater.h"
+
+typedef std::vector<uint8_t> Bytes;
+
+static int failures = 0;
+
+static void expect(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// --- encoder (greedy, closest longest match; same bitstream as ota_upload.py) --
+
+static Bytes heatshrinkCompress(const Bytes &data) {
+    const size_t window = HeatshrinkDecoder::WINDOW_SIZE;
+    const size_t maxLen = 1u << HeatshrinkDecoder::LOOKAHEAD_BITS;
+    const size_t minLen = (1 + HeatshrinkDecoder::WINDOW_BITS + HeatshrinkDecoder::LOOKAHEAD_BITS) / 9 + 1;
+    Bytes buf(window, 0); // the decoder window starts zero-filled
+    buf.insert(buf.end(), data.begin(), data.end());
+
+    Bytes out;
+    uint8_t current = 0;
+    int used = 0;
+    auto put = [&](uint32_t value, int bits) {
+        for (int shift = bits - 1; shift >= 0; shift--) {
+            current = static_cast<uint8_t>((current << 1) | ((value >> shift) & 1));
+            if (++used == 8) {
+                out.push_back(current);
+                current = 0;
+                used = 0;
+            }
+        }
+    };
+
+    for (size_t pos = window; pos < buf.size();) {
+        size_t bestLen = 0, bestOffset = 0;
+        for (size_t offset = 1; offset <= window; offset++) {
+            size_t length = 0;
+            while (length < maxLen && pos + length < buf.size() && buf[pos - offset + length] == buf[pos + length]) {
+                length++;
+            }
+            if (length > bestLen) {
+                bestLen = length;
+                bestOffset = offset;
+                if (length == maxLen) {
+                    break;
+                }
+            }
+        }
+        if (bestLen >= minLen) {
+            put(0, 1);
+            put(static_cast<uint32_t>(bestOffset - 1), HeatshrinkDecoder::WINDOW_BITS);
+            put(static_cast<uint32_t>(bestLen - 1), HeatshrinkDecoder::LOOKAHEAD_BITS);
+            pos += bestLen;
+        } else {
+            put(1, 1);
+            put(buf[pos], 8);
+            pos++;
+        }
+    }
+    if (used) {
+        out.push_back(static_cast<uint8_t>(current << (8 - used)));
+    }
+    return out;
+}
+
+// --- sinks and samples ------------------------------------------------------
+
+class MemorySink : public FlashSink {
+public:
+    Bytes bytes;
+    std::vector<size_t> writes;
+    size_t failAfter = SIZE_MAX;
+
+    bool write(const uint8_t *data, size_t len) override {
+        if (bytes.size() + len > failAfter) {
+            return false;
+        }
+        bytes.insert(bytes.end(), data, data + len);
+        writes.push_back(len);
+        return true;
+    }
+};
+
+static uint32_t randomState = 12345;
+
+static uint8_t nextRandom() {
+    randomState = randomState * 1103515245u + 12345u;
+    return static_cast<uint8_t>(randomState >> 16);
+}
+
+// Firmware-like mix: runs of zeros, repeated text, and noise.
+static Bytes sampleImage(size_t size) {
+    static const char TEXT[] = "[T+%9lu ms][%s] %s\nColor_Shadow colorshadow/%s/state ";
+    Bytes image;
+    while (image.size() < size) {
+        switch (nextRandom() % 3) {
+        case 0:
+            image.insert(image.end(), 40 + nextRandom() % 200, 0);
+            break;
+        case 1:
+            image.insert(image.end(), TEXT, TEXT + sizeof(TEXT) - 1);
+            break;
+        default:
+            for (int i = 0; i < 300; i++) {
+                image.push_back(nextRandom());
+            }
+            break;
+        }
+    }
+    image.resize(size);
+    return image;
+}
+
+static Bytes decode(const Bytes &compressed, size_t piece, MemorySink &sink) {
+    ChunkWriter writer(sink);
+    HeatshrinkDecoder decoder(writer);
+    writer.reset();
+    decoder.reset();
+    for (size_t i = 0; i < compressed.size(); i += piece) {
+        if (!decoder.feed(compressed.data() + i, std::min(piece, compressed.size() - i))) {
+            break;
+        }
+    }
+    writer.flush();
+    return sink.bytes;
+}
+
+// --- decoder and chunk writer ---------------------------------------------
+
+static void testRoundTrip(const char *name, const Bytes &image) {
+    const Bytes compressed = heatshrinkCompress(image);
+    static const size_t PIECES[] = {1, 3, 7, 64, 1436, 4096, SIZE_MAX};
+    for (size_t p = 0; p < sizeof(PIECES) / sizeof(PIECES[0]); p++) {
+        MemorySink sink;
+        const Bytes decoded = decode(compressed, PIECES[p], sink);
+        char what[96];
+        snprintf(what, sizeof(what), "%s round trip in %zu-byte pieces", name, PIECES[p]);
+        expect(decoded == image, what);
+        bool aligned = true;
+        for (size_t w = 0; w + 1 < sink.writes.size(); w++) {
+            aligned = aligned && sink.writes[w] == ChunkWriter::CHUNK_SIZE;
+        }
+        snprintf(what, sizeof(what), "%s sink writes are whole chunks", name);
+        expect(aligned, what);
+    }
+    printf("%-12s %7zu -> %7zu bytes\n", name, image.size(), compressed.size());
+}
+
+static void testDecoder() {
+    testRoundTrip("empty", Bytes());
+    testRoundTrip("zeros", Bytes(10000, 0));
+    testRoundTrip("one chunk", sampleImage(ChunkWriter::CHUNK_SIZE));
+    testRoundTrip("mixed", sampleImage(50001));
+    Bytes noise;
+    for (int i = 0; i < 9000; i++) {
+        noise.push_back(nextRandom());
+    }
+    testRoundTrip("noise", noise);
+
+    // A stream cut short decodes to a strict prefix of the image.
+    const Bytes image = sampleImage(20000);
+    const Bytes compressed = heatshrinkCompress(image);
+    MemorySink sink;
+    const Bytes partial = decode(Bytes(compressed.begin(), compressed.begin() + compressed.size() / 2), 1436, sink);
+    expect(partial.size() < image.size() && std::equal(partial.begin(), partial.end(), image.begin()),
+           "truncated stream decodes to a prefix");
+
+    // Sink failure stops the decoder and sticks.
+    MemorySink failing;
+    failing.failAfter = ChunkWriter::CHUNK_SIZE;
+    ChunkWriter writer(failing);
+    HeatshrinkDecoder decoder(writer);
+    writer.reset();
+    decoder.reset();
+    expect(!decoder.feed(compressed.data(), compressed.size()), "decoder reports a failing sink");
+    expect(writer.hasFailed() && !writer.flush() && failing.bytes.size() == ChunkWriter::CHUNK_SIZE,
+           "chunk writer stays failed");
+}
+
+// --- OtaUpdater -------------------------------------------------------------
+
+static const char KEY[] = OTA_HMAC_KEY;
+
+static void toHex(const uint8_t *bytes, size_t len, char *out) {
+    for (size_t i = 0; i < len; i++) {
+        snprintf(out + i * 2, 3, "%02x", bytes[i]);
+    }
+}
+
+struct Upload {
+    char sha256[65];
+    char signature[65];
+};
+
+static Upload sign(const Bytes &image, const char *key) {
+    uint8_t digest[32], mac[32];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts_ret(&ctx, 0);
+    mbedtls_sha256_update_ret(&ctx, image.data(), image.size());
+    mbedtls_sha256_finish_ret(&ctx, digest);
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), reinterpret_cast<const uint8_t *>(key),
+                    strlen(key), digest, sizeof(digest), mac);
+    Upload upload;
+    toHex(digest, sizeof(digest), upload.sha256);
+    toHex(mac, sizeof(mac), upload.signature);
+    return upload;
+}
+
+// Streams `body` in network-sized segments the way handleOtaBody() does.
+static bool upload(OtaUpdater &ota, const Upload &signed_, const Bytes &body, bool compressed) {
+    if (!ota.begin(signed_.sha256, signed_.signature, compressed ? "heatshrink" : "raw")) {
+        return false;
+    }
+    for (size_t i = 0; i < body.size(); i += 1436) {
+        if (!ota.write(body.data() + i, std::min<size_t>(1436, body.size() - i))) {
+            return false;
+        }
+    }
+    return ota.finish();
+}
+
+static void testUpdater() {
+    static OtaUpdater ota;
+    Update.hostSetPartition(true);
+    const Bytes image = sampleImage(70000);
+    const Bytes compressed = heatshrinkCompress(image);
+    const Upload good = sign(image, KEY);
+
+    expect(upload(ota, good, compressed, true), "signed compressed upload succeeds");
+    expect(Update.hostImage() == image && Update.hostEnded() && ota.imageBytes() == image.size(),
+           "slot holds the image");
+    expect(upload(ota, good, image, false), "signed raw upload succeeds");
+    expect(Update.hostImage() == image, "raw slot holds the image");
+
+    Bytes altered = image;
+    altered[12345] ^= 0x01;
+    expect(!upload(ota, good, heatshrinkCompress(altered), true) && strcmp(ota.lastError(), "sha256 mismatch") == 0,
+           "altered image fails the sha256 check");
+    expect(!ota.isActive(), "failed upload releases the updater");
+
+    expect(!upload(ota, good, Bytes(compressed.begin(), compressed.end() - 100), true) &&
+               strcmp(ota.lastError(), "sha256 mismatch") == 0,
+           "truncated upload fails the sha256 check");
+
+    const Upload forged = sign(image, "not the key");
+    expect(!upload(ota, forged, compressed, true) && ota.wasDenied() &&
+               strcmp(ota.lastError(), "signature invalid") == 0,
+           "wrong key is denied");
+    expect(!ota.begin(good.sha256, nullptr, "heatshrink") && ota.wasDenied(), "missing signature is denied");
+    expect(!ota.begin("abc", good.signature, "heatshrink") && !ota.wasDenied() && ota.wasMalformed(),
+           "short sha256 is a bad request");
+    expect(!ota.begin(good.sha256, good.signature, "identity") && ota.wasMalformed() && !ota.wasDenied(),
+           "unknown encoding is a bad request");
+    expect(!ota.begin(good.sha256, good.signature, nullptr) && ota.wasMalformed(), "missing encoding is a bad request");
+    expect(upload(ota, good, compressed, true) && !ota.wasMalformed(), "a good upload clears the flag");
+
+    Update.hostFailAfter(3 * ChunkWriter::CHUNK_SIZE);
+    expect(!upload(ota, good, compressed, true) && strcmp(ota.lastError(), "flash write failed") == 0,
+           "failing flash aborts the upload");
+    Update.hostFailAfter(SIZE_MAX);
+
+    Update.hostSetPartition(false);
+    expect(!upload(ota, good, compressed, true) && strcmp(ota.lastError(), "no OTA partition") == 0,
+           "missing slot is reported");
+}
+
+static void testKnownDigests() {
+    // FIPS 180-2 "abc" and RFC 4231 test case 2.
+    uint8_t out[32];
+    char hex[65];
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts_ret(&ctx, 0);
+    mbedtls_sha256_update_ret(&ctx, reinterpret_cast<const uint8_t *>("abc"), 3);
+    mbedtls_sha256_finish_ret(&ctx, out);
+    toHex(out, sizeof(out), hex);
+    expect(strcmp(hex, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad") == 0, "sha256(abc)");
+
+    const char *data = "what do ya want for nothing?";
+    mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), reinterpret_cast<const uint8_t *>("Jefe"), 4,
+                    reinterpret_cast<const uint8_t *>(data), strlen(data), out);
+    toHex(out, sizeof(out), hex);
+    expect(strcmp(hex, "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843") == 0, "hmac-sha256");
+}
+
+static bool readFile(const char *path, Bytes &out) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out.insert(out.end(), buffer, buffer + n);
+    }
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char **argv) {
+    testKnownDigests();
+    testDecoder();
+    testUpdater();
+
+    if (argc == 3) {
+        Bytes image, compressed;
+        if (readFile(argv[1], image) && readFile(argv[2], compressed)) {
+            MemorySink sink;
+            expect(decode(compressed, 1436, sink) == image, "ota_upload.py output decodes to the image");
+            printf("%-12s %7zu -> %7zu bytes\n", "ota_upload", image.size(), compressed.size());
+        } else {
+            failures++;
+        }
+    }
+
+    printf("%s\n", failures ? "ota_test: FAILED" : "ota_test: ok");
+    return failures ? 1 : 0;
+}
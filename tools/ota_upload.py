@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Compress a firmware image with heatshrink (w=10, l=5) and stream it to /api/ota.
+
+The upload is signed with HMAC-SHA256 over the image digest, keyed with the
+same LAMP_OTA_KEY the firmware was built with.
+
+Usage:
+    LAMP_OTA_KEY=... python tools/ota_upload.py .pio/build/esp32-c3-devkitm-1/firmware.bin 192.168.1.80
+    python tools/ota_upload.py firmware.bin --out firmware.hs   # compress only
+"""
+
+import argparse
+import hashlib
+import hmac
+import os
+import sys
+import urllib.request
+
+WINDOW_BITS = 10
+LOOKAHEAD_BITS = 5
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.current = 0
+        self.used = 0
+
+    def put(self, value, bits):
+        for shift in range(bits - 1, -1, -1):
+            self.current = (self.current << 1) | ((value >> shift) & 1)
+            self.used += 1
+            if self.used == 8:
+                self.out.append(self.current)
+                self.current = 0
+                self.used = 0
+
+    def finish(self):
+        if self.used:
+            self.out.append(self.current << (8 - self.used))
+        return bytes(self.out)
+
+
+def heatshrink_compress(data):
+    window = 1 << WINDOW_BITS
+    max_len = 1 << LOOKAHEAD_BITS
+    # Backrefs cost 1 + W + L bits; only worth it above this length.
+    min_len = (1 + WINDOW_BITS + LOOKAHEAD_BITS) // 9 + 1
+    buf = bytes(window) + data  # decoder window starts zero-filled
+    heads = {}
+    writer = BitWriter()
+    pos = window
+    end = len(buf)
+
+    def remember(p):
+        if p + 3 <= end:
+            heads.setdefault(buf[p:p + 3], []).append(p)
+
+    for p in range(window - 2, window):
+        remember(p)
+
+    while pos < end:
+        best_len, best_off = 0, 0
+        for cand in reversed(heads.get(buf[pos:pos + 3], [])):
+            off = pos - cand
+            if off > window:
+                break
+            length = 0
+            while length < max_len and pos + length < end and buf[cand + length] == buf[pos + length]:
+                length += 1
+            if length > best_len:
+                best_len, best_off = length, off
+                if length == max_len:
+                    break
+        if best_len >= min_len:
+            writer.put(0, 1)
+            writer.put(best_off - 1, WINDOW_BITS)
+            writer.put(best_len - 1, LOOKAHEAD_BITS)
+            step = best_len
+        else:
+            writer.put(1, 1)
+            writer.put(buf[pos], 8)
+            step = 1
+        for p in range(pos, pos + step):
+            remember(p)
+        pos += step
+    return writer.finish()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("image")
+    parser.add_argument("host", nargs="?")
+    parser.add_argument("--out", help="write the compressed image here instead of uploading")
+    parser.add_argument("--raw", action="store_true", help="upload uncompressed")
+    parser.add_argument("--key", default=os.environ.get("LAMP_OTA_KEY"),
+                        help="OTA signing key (default: $LAMP_OTA_KEY)")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+    digest = hashlib.sha256(image).hexdigest()
+    body = image if args.raw else heatshrink_compress(image)
+    print(f"image {len(image)} bytes -> {len(body)} bytes, sha256 {digest}")
+
+    if args.out:
+        with open(args.out, "wb") as f:
+            f.write(body)
+        return 0
+    if not args.host:
+        parser.error("host is required unless --out is given")
+    if not args.key:
+        parser.error("set LAMP_OTA_KEY or pass --key")
+
+    signature = hmac.new(args.key.encode(), bytes.fromhex(digest), hashlib.sha256).hexdigest()
+    encoding = "raw" if args.raw else "heatshrink"
+    url = f"http://{args.host}/api/ota?sha256={digest}&sig={signature}&encoding={encoding}"
+    request = urllib.request.Request(url, data=body, method="POST",
+                                     headers={"Content-Type": "application/octet-stream"})
+    with urllib.request.urlopen(request, timeout=120) as response:
+        print(response.status, response.read().decode())
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""Measure command latency for each power policy and lamp state.
+
+For every policy/state pair the lamp is left alone long enough to idle, then
+woken with a colour command and the HTTP round trip is timed. That covers
+modem-sleep beacon delay, CPU wake and the PWM write done inside the handler.
+The "pwm us" column is the lamp's own average from command arrival to the
+first PWM write after it (wakeToPwmUs in /api/power).
+Each phase also dwells idle for --dwell seconds and prints wall-clock start
+and end times, so readings from an external USB power meter can be averaged
+over the same windows.
+
+Usage:
+    python tools/power_probe.py 192.168.1.80
+    python tools/power_probe.py 192.168.1.80 --policies balanced saver --samples 20 --dwell 60
+"""
+
+import argparse
+import json
+import random
+import statistics
+import sys
+import time
+import urllib.request
+
+POLICIES = ["performance", "balanced", "saver"]
+IDLE_AFTER_S = 3.0  # PowerGovernor::IDLE_AFTER_MS
+HEADERS = {"Content-Type": "application/octet-stream"}
+
+
+def post(host, path, body):
+    request = urllib.request.Request(f"http://{host}{path}", data=body.encode(), method="POST", headers=HEADERS)
+    with urllib.request.urlopen(request, timeout=10) as response:
+        return response.read()
+
+
+def get_json(host, path):
+    with urllib.request.urlopen(f"http://{host}{path}", timeout=10) as response:
+        return json.loads(response.read())
+
+
+def settle(host, state):
+    if state == "dark":
+        post(host, "/api/mode", "mode=off")
+    else:
+        post(host, "/postRGB", "r=120&g=60&b=20")
+
+
+def measure(host, state, samples):
+    latencies = []
+    for _ in range(samples):
+        settle(host, state)
+        time.sleep(IDLE_AFTER_S + 1.0 + random.random())  # let the governor idle, off the beacon phase
+        # Differ from the settled colour so the handler really writes PWM.
+        body = f"r={random.randint(150, 255)}&g={random.randint(0, 60)}&b={random.randint(0, 60)}"
+        start = time.perf_counter()
+        post(host, "/postRGB", body)
+        latencies.append((time.perf_counter() - start) * 1000.0)
+    return latencies
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("host")
+    parser.add_argument("--policies", nargs="+", default=POLICIES, choices=POLICIES)
+    parser.add_argument("--samples", type=int, default=10)
+    parser.add_argument("--dwell", type=float, default=30.0, help="idle seconds per phase for the power meter")
+    args = parser.parse_args()
+
+    rows = []
+    for policy in args.policies:
+        post(args.host, "/api/power", f"policy={policy}")
+        for state in ("static", "dark"):
+            settle(args.host, state)
+            start = time.strftime("%H:%M:%S")
+            time.sleep(args.dwell)
+            end = time.strftime("%H:%M:%S")
+            latencies = measure(args.host, state, args.samples)
+            report = get_json(args.host, "/api/power")
+            latencies.sort()
+            rows.append((policy, state, start, end, statistics.median(latencies),
+                         latencies[int(0.95 * (len(latencies) - 1))], latencies[-1],
+                         report["lightSleep"], report["wakeToPwmUs"]["avg"]))
+            print(f"{policy:12} {state:6} meter window {start}-{end}", file=sys.stderr)
+
+    print(f"{'policy':12} {'state':6} {'meter window':17} {'p50 ms':>7} {'p95 ms':>7} {'max ms':>7} "
+          f"{'light':11} {'pwm us':>7}")
+    for policy, state, start, end, p50, p95, worst, light, pwm_us in rows:
+        print(f"{policy:12} {state:6} {start}-{end} {p50:7.1f} {p95:7.1f} {worst:7.1f} {light:11} {pwm_us:7d}")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
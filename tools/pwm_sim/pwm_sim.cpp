@@ -0,0 +1,134 @@
+// Simulates the LED output stage for every PWM timing preset and phase mode
+// and reports how much of the period the channels overlap. Colors go through
+// the native LEDController (trims and the unlocked power limit) and the
+// duties and phases come from the same PwmStage.h math the firmware uses.
+//
+//   make -C tools pwm_sim && tools/build/pwm_sim
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <vector>
+#include "LEDController.h"
+#include "PartyRenderer.h"
+#include "PwmStage.h"
+#include "Scenes.h"
+
+struct Color {
+    int red;
+    int green;
+    int blue;
+};
+
+struct Result {
+    double worstPeak = 0;   // channels on at once, worst color, as a share of all three
+    double meanPeak = 0;
+    double meanRipple = 0;  // peak minus average combined duty
+    int worstStep = 0;      // largest change in channels on from one counter tick to the next
+};
+
+static int channelOutput[3];
+
+static void captureWrite(int channel, int duty) {
+    if (channel >= 0 && channel < 3) {
+        channelOutput[channel] = duty;
+    }
+}
+
+static bool isOn(uint32_t tick, uint32_t hpoint, uint32_t duty, uint32_t period) {
+    return ((tick + period - hpoint) & (period - 1)) < duty;
+}
+
+static Result simulate(const std::vector<Color> &outputs, const PwmTiming &timing) {
+    Result result;
+    const uint32_t period = pwmPeriodTicks(timing.resolution);
+    for (size_t c = 0; c < outputs.size(); c++) {
+        const int logical[3] = {outputs[c].red, outputs[c].green, outputs[c].blue};
+        uint32_t duty[3];
+        uint32_t hpoint[3];
+        for (size_t i = 0; i < 3; i++) {
+            duty[i] = pwmScaleDuty(logical[i], timing.resolution);
+        }
+        pwmPhasePoints(duty, 3, timing.resolution, timing.phase, hpoint);
+
+        int peak = 0;
+        int step = 0;
+        int previous = 0;
+        for (size_t i = 0; i < 3; i++) {
+            previous += isOn(period - 1, hpoint[i], duty[i], period);
+        }
+        for (uint32_t tick = 0; tick < period; tick++) {
+            int on = 0;
+            for (size_t i = 0; i < 3; i++) {
+                on += isOn(tick, hpoint[i], duty[i], period);
+            }
+            const int change = on > previous ? on - previous : previous - on;
+            peak = on > peak ? on : peak;
+            step = change > step ? change : step;
+            previous = on;
+        }
+
+        const double average = (duty[0] + duty[1] + duty[2]) / (3.0 * period);
+        const double peakShare = peak / 3.0;
+        result.worstPeak = peakShare > result.worstPeak ? peakShare : result.worstPeak;
+        result.meanPeak += peakShare;
+        result.meanRipple += peakShare - average;
+        result.worstStep = step > result.worstStep ? step : result.worstStep;
+    }
+    result.meanPeak /= outputs.size();
+    result.meanRipple /= outputs.size();
+    return result;
+}
+
+int main() {
+    const LedChannelConfig channelMap[3] = {{7, 0, RED_TRIM}, {6, 1, GREEN_TRIM}, {5, 2, BLUE_TRIM}};
+    LampLEDController ledController(channelMap);
+    hostSetLedcWriteHook(captureWrite);
+    ledController.begin();
+    ledController.unlock(); // worst case: the higher power limit
+
+    std::vector<Color> requests;
+    for (size_t i = 0; i < SCENE_COUNT; i++) {
+        Color color = {SCENES[i].red, SCENES[i].green, SCENES[i].blue};
+        requests.push_back(color);
+    }
+    for (int hue = 0; hue < 360; hue += 5) {
+        Color color;
+        PartyRenderer::hsvToRgb11(static_cast<float>(hue), 1.0f, 1.0f, color.red, color.green, color.blue);
+        requests.push_back(color);
+    }
+    Color white = {2047, 2047, 2047};
+    requests.push_back(white);
+
+    // Run each request through the real trim and power-limit path.
+    std::vector<Color> outputs;
+    for (size_t i = 0; i < requests.size(); i++) {
+        ledController.setPWMDirectly(0, 0, 0);
+        ledController.setPWMDirectly(requests[i].red, requests[i].green, requests[i].blue);
+        Color out = {channelOutput[0], channelOutput[1], channelOutput[2]};
+        outputs.push_back(out);
+    }
+
+    const PwmTiming presets[] = {
+        {19000, 11, PwmPhaseMode::ALIGNED},
+        {4000, 14, PwmPhaseMode::ALIGNED},
+        {25000, 10, PwmPhaseMode::ALIGNED},
+    };
+    printf("%zu colors, unlocked power limit\n\n", outputs.size());
+    printf("%-6s %-4s %-10s %10s %10s %10s %6s\n", "Hz", "bits", "phase", "worst pk", "mean pk", "ripple", "step");
+    for (size_t p = 0; p < sizeof(presets) / sizeof(presets[0]); p++) {
+        for (uint8_t phase = 0; phase <= static_cast<uint8_t>(PwmPhaseMode::PACKED); phase++) {
+            PwmTiming timing = presets[p];
+            timing.phase = static_cast<PwmPhaseMode>(phase);
+            if (!pwmTimingValid(timing)) {
+                printf("%-6lu %-4u %-10s invalid\n", static_cast<unsigned long>(timing.frequency),
+                       timing.resolution, pwmPhaseName(timing.phase));
+                continue;
+            }
+            const Result result = simulate(outputs, timing);
+            printf("%-6lu %-4u %-10s %9.1f%% %9.1f%% %9.1f%% %6d\n", static_cast<unsigned long>(timing.frequency),
+                   timing.resolution, pwmPhaseName(timing.phase), result.worstPeak * 100.0,
+                   result.meanPeak * 100.0, result.meanRipple * 100.0, result.worstStep);
+        }
+    }
+    return 0;
+}
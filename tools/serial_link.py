@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+"""Drive the lamp over its USB CDC port with the binary serial protocol.
+
+Frames are COBS-encoded [type, seq, payload..., crc16] between 0x00 bytes
+(lib/SerialLink/SerialProtocol.h). Anything between frames is the firmware's
+normal log output and is echoed to stderr. No pyserial needed: the port is
+opened as a raw tty, so the same commands work against tools/build/serial_stub.
+
+Usage:
+    python tools/serial_link.py /dev/ttyACM0 status
+    python tools/serial_link.py /dev/ttyACM0 color 255 120 0
+    python tools/serial_link.py /dev/ttyACM0 frame 2047 0 512
+    python tools/serial_link.py /dev/ttyACM0 bench --seconds 5 --rate 500
+"""
+
+import argparse
+import os
+import select
+import statistics
+import struct
+import sys
+import termios
+import time
+import tty
+
+PING, STATUS, COLOR, MODE, SCENE, PARTY_HZ, UNLOCK, RESET, FRAME = 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x10
+NO_ACK = 0x40
+REPLY = 0x80
+MODES = {"party": 0, "wifi": 1, "off": 2}
+STATUS_NAMES = ["ok", "bad length", "bad value", "unknown command"]
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) & 0xFFFF if crc & 0x8000 else (crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray([0])
+    code_at, code = 0, 1
+    for byte in data:
+        if byte == 0:
+            out[code_at] = code
+            code_at, code = len(out), 1
+            out.append(0)
+            continue
+        out.append(byte)
+        code += 1
+        if code == 0xFF:
+            out[code_at] = code
+            code_at, code = len(out), 1
+            out.append(0)
+    out[code_at] = code
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code != 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_frame(frame_type, seq, payload=b""):
+    raw = bytes([frame_type, seq]) + payload
+    return b"\x00" + cobs_encode(raw + struct.pack("<H", crc16(raw))) + b"\x00"
+
+
+class Link:
+    def __init__(self, path, quiet=False):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        termios.tcflush(self.fd, termios.TCIFLUSH)
+        self.buffer = bytearray()
+        self.seq = 0
+        self.quiet = quiet
+
+    def send(self, frame_type, payload=b"", ack=True):
+        self.seq = (self.seq + 1) & 0xFF
+        data = encode_frame(frame_type | (0 if ack else NO_ACK), self.seq, payload)
+        view = memoryview(data)
+        while view:
+            written = os.write(self.fd, view)
+            view = view[written:]
+        return self.seq
+
+    def _chunks(self, timeout):
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if ready:
+            self.buffer += os.read(self.fd, 4096)
+        while b"\x00" in self.buffer:
+            chunk, _, rest = bytes(self.buffer).partition(b"\x00")
+            self.buffer = bytearray(rest)
+            if chunk:
+                yield chunk
+
+    def replies(self, timeout):
+        """Yields (type, seq, status, data) for every reply until timeout; logs go to stderr."""
+        deadline = time.monotonic() + timeout
+        while True:
+            remaining = deadline - time.monotonic()
+            if remaining <= 0:
+                return
+            for chunk in self._chunks(remaining):
+                raw = cobs_decode(chunk)
+                if raw and len(raw) >= 5 and raw[0] & REPLY and crc16(raw[:-2]) == struct.unpack("<H", raw[-2:])[0]:
+                    yield raw[0] & ~REPLY & 0x3F, raw[1], raw[2], raw[3:-2]
+                elif not self.quiet:
+                    sys.stderr.write(chunk.decode(errors="replace"))
+
+    def request(self, frame_type, payload=b"", timeout=1.0):
+        seq = self.send(frame_type, payload)
+        for reply_type, reply_seq, status, data in self.replies(timeout):
+            if reply_seq == seq and reply_type == frame_type:
+                return status, data
+        raise TimeoutError(f"no reply to command 0x{frame_type:02x}")
+
+
+def parse_status(data):
+    mode, unlocked, channels, mhz, r, g, b, frames, bad_crc, malformed, overflow = struct.unpack("<BBBHBBBIIII", data)
+    mode_name = {v: k for k, v in MODES.items()}.get(mode, str(mode))
+    return {"mode": mode_name, "unlocked": bool(unlocked), "channels": channels, "party_hz": mhz / 1000.0,
+            "color": [r, g, b], "frames": frames, "bad_crc": bad_crc, "malformed": malformed, "overflow": overflow}
+
+
+def bench(link, seconds, rate, ack_every):
+    # Round-trip latency: one acknowledged PING at a time.
+    rtts = []
+    for i in range(200):
+        start = time.perf_counter()
+        link.request(PING, struct.pack("<I", i))
+        rtts.append((time.perf_counter() - start) * 1e6)
+    rtts.sort()
+    print(f"ping round trip: median {statistics.median(rtts):.0f} us, "
+          f"p99 {rtts[int(len(rtts) * 0.99) - 1]:.0f} us, max {rtts[-1]:.0f} us")
+
+    # Throughput: stream FRAME updates, acknowledging every ack_every-th one so
+    # a stalled device shows up as a timeout instead of a silently full buffer.
+    before = parse_status(link.request(STATUS)[1])
+    channels = before["channels"]
+    interval = 1.0 / rate if rate else 0.0
+    sent, acked, failed, total_bytes = 0, 0, 0, 0
+    start = time.perf_counter()
+    next_send = start
+    while time.perf_counter() - start < seconds:
+        level = (sent * 8) % 2048
+        payload = struct.pack(f"<{channels}H", *([level] * channels))
+        ack = ack_every and sent % ack_every == 0
+        seq = link.send(FRAME, payload, ack=bool(ack))
+        total_bytes += len(encode_frame(FRAME, seq, payload))
+        sent += 1
+        if ack:
+            for reply_type, reply_seq, status, _ in link.replies(1.0):
+                if reply_seq == seq:
+                    acked += 1
+                    failed += status != 0
+                    break
+        if interval:
+            next_send += interval
+            delay = next_send - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+    elapsed = time.perf_counter() - start
+    after = parse_status(link.request(STATUS, timeout=2.0)[1])
+
+    # frames counts every frame the device decoded, including our pings and status requests
+    received = after["frames"] - before["frames"] - 1
+    errors = sum(after[k] - before[k] for k in ("bad_crc", "malformed", "overflow"))
+    print(f"streamed {sent} frames in {elapsed:.2f} s: {sent / elapsed:.0f} frames/s, "
+          f"{total_bytes / elapsed / 1024:.1f} KiB/s")
+    print(f"device decoded {received}/{sent}, {acked} acked ({failed} rejected), {errors} framing errors")
+    return 0 if received == sent and errors == 0 and failed == 0 else 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("port", help="serial device, e.g. /dev/ttyACM0 or the serial_stub path")
+    parser.add_argument("--quiet", action="store_true", help="do not echo device log lines")
+    sub = parser.add_subparsers(dest="command", required=True)
+    sub.add_parser("ping")
+    sub.add_parser("status")
+    color = sub.add_parser("color")
+    color.add_argument("rgb", type=int, nargs=3)
+    mode = sub.add_parser("mode")
+    mode.add_argument("mode", choices=sorted(MODES))
+    scene = sub.add_parser("scene")
+    scene.add_argument("name")
+    party = sub.add_parser("party")
+    party.add_argument("hz", type=float)
+    sub.add_parser("unlock")
+    sub.add_parser("reset")
+    frame = sub.add_parser("frame", help="raw channel values, 0-2047 each, channel-map order")
+    frame.add_argument("values", type=int, nargs="+")
+    bench_parser = sub.add_parser("bench", help="measure round-trip latency and FRAME throughput")
+    bench_parser.add_argument("--seconds", type=float, default=5.0)
+    bench_parser.add_argument("--rate", type=float, default=0, help="frames/s to stream, 0 = as fast as possible")
+    bench_parser.add_argument("--ack-every", type=int, default=50)
+    args = parser.parse_args()
+
+    link = Link(args.port, quiet=args.quiet)
+    if args.command == "bench":
+        return bench(link, args.seconds, args.rate, args.ack_every)
+
+    requests = {
+        "ping": lambda: (PING, b""),
+        "status": lambda: (STATUS, b""),
+        "color": lambda: (COLOR, bytes(args.rgb)),
+        "mode": lambda: (MODE, bytes([MODES[args.mode]])),
+        "scene": lambda: (SCENE, args.name.encode()),
+        "party": lambda: (PARTY_HZ, struct.pack("<H", round(args.hz * 1000))),
+        "unlock": lambda: (UNLOCK, b""),
+        "reset": lambda: (RESET, b""),
+        "frame": lambda: (FRAME, struct.pack(f"<{len(args.values)}H", *args.values)),
+    }
+    frame_type, payload = requests[args.command]()
+    status, data = link.request(frame_type, payload)
+    if status != 0:
+        print(f"error: {STATUS_NAMES[status] if status < len(STATUS_NAMES) else status}", file=sys.stderr)
+        return 1
+    if args.command == "status":
+        for key, value in parse_status(data).items():
+            print(f"{key}: {value}")
+    else:
+        print("ok")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,215 @@
+// Pseudo-terminal stand-in for the lamp's USB CDC port. Runs the firmware's
+// SerialLink, LampCommands, Scheduler, StateHandler, PartyRenderer and
+// LEDController natively, with the virtual clock tracking wall time, and
+// interleaves log lines with replies the way the device does.
+//
+//   make -C tools serial_stub
+//   tools/build/serial_stub [--link /tmp/lamp-tty] [--quiet]
+//   python tools/serial_link.py /tmp/lamp-tty status
+
+#include <Arduino.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "DebugLog.h"
+#include "LEDController.h"
+#include "LampCommands.h"
+#include "PartyRenderer.h"
+#include "Scheduler.h"
+#include "SerialLink.h"
+#include "State.h"
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void requestStop(int) { stopRequested = 1; }
+
+// Master side of the pty. Writes block until the client drains them, like
+// the CDC driver does once its TX buffer is full.
+class PtyStream : public Stream {
+public:
+    explicit PtyStream(int fd) : fd(fd) {}
+
+    int available() override {
+        fill();
+        return static_cast<int>(end - start);
+    }
+
+    int read() override {
+        if (start == end) {
+            fill();
+        }
+        return start == end ? -1 : buffer[start++];
+    }
+
+    size_t write(const uint8_t *data, size_t len) override {
+        size_t sent = 0;
+        while (sent < len) {
+            const ssize_t n = ::write(fd, data + sent, len - sent);
+            if (n > 0) {
+                sent += static_cast<size_t>(n);
+            } else if (n < 0 && errno == EAGAIN) {
+                struct pollfd waitFd = {fd, POLLOUT, 0};
+                ::poll(&waitFd, 1, 100);
+            } else if (n < 0 && errno != EINTR) {
+                break;
+            }
+        }
+        return sent;
+    }
+
+private:
+    int fd;
+    uint8_t buffer[1024];
+    size_t start = 0;
+    size_t end = 0;
+
+    void fill() {
+        if (start != end) {
+            return;
+        }
+        start = end = 0;
+        const ssize_t n = ::read(fd, buffer, sizeof(buffer));
+        if (n > 0) {
+            end = static_cast<size_t>(n);
+        }
+    }
+};
+
+static PtyStream *logPort = nullptr;
+
+static void writeLog(const char *text, size_t len) {
+    if (logPort) {
+        logPort->write(reinterpret_cast<const uint8_t *>(text), len);
+    }
+}
+
+static uint64_t wallMicros() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000ULL + static_cast<uint64_t>(now.tv_nsec) / 1000ULL;
+}
+
+static int openPty(const char *linkPath, int &slaveFd) {
+    const int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return -1;
+    }
+    const char *slaveName = ptsname(master);
+    // Hold the slave open in raw mode: no echo or newline translation can
+    // touch the binary frames, and the master never sees EIO between clients.
+    slaveFd = open(slaveName, O_RDWR | O_NOCTTY);
+    struct termios tio;
+    if (slaveFd < 0 || tcgetattr(slaveFd, &tio) != 0) {
+        perror(slaveName);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(slaveFd, TCSANOW, &tio);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+
+    if (linkPath) {
+        unlink(linkPath);
+        if (symlink(slaveName, linkPath) != 0) {
+            perror(linkPath);
+            return -1;
+        }
+    }
+    printf("%s\n", linkPath ? linkPath : slaveName);
+    fflush(stdout);
+    return master;
+}
+
+int main(int argc, char **argv) {
+    const char *linkPath = nullptr;
+    bool quiet = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--link") == 0 && i + 1 < argc) {
+            linkPath = argv[++i];
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else {
+            fprintf(stderr, "usage: %s [--link PATH] [--quiet]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int slaveFd = -1;
+    const int master = openPty(linkPath, slaveFd);
+    if (master < 0) {
+        return 2;
+    }
+    signal(SIGINT, requestStop);
+    signal(SIGTERM, requestStop);
+
+    PtyStream port(master);
+    logPort = &port;
+    hostSetSerialWriteHook(writeLog);
+    hostSetSerialEnabled(!quiet);
+
+    const uint64_t epoch = wallMicros();
+    const LedChannelConfig channelMap[LAMP_LED_CHANNELS] = {{7, 0, RED_TRIM}, {6, 1, GREEN_TRIM}, {5, 2, BLUE_TRIM}};
+    LampLEDController ledController(channelMap);
+    StateHandler stateHandler(ledController);
+    Scheduler scheduler(ledController, stateHandler);
+    LampCommands lampCommands(ledController, stateHandler, scheduler);
+    SerialLink serialLink(port, lampCommands);
+    PartyRenderer partyRenderer;
+
+    ledController.begin();
+    stateHandler.begin();
+    scheduler.begin();
+    logStatus("BOOT", "Serial stand-in ready");
+
+    // Same cadence as loop(): serial every pass, render every 20 ms,
+    // a log line every 2 s.
+    unsigned long lastUpdate = 0;
+    unsigned long lastHeartbeat = 0;
+    OperationMode lastMode = stateHandler.getCurrentMode();
+    while (!stopRequested) {
+        hostSetMicros(wallMicros() - epoch);
+        serialLink.poll();
+
+        const unsigned long now = millis();
+        if (now - lastUpdate >= 20) {
+            lastUpdate = now;
+            lampCommands.applyQueued();
+            scheduler.tick(now);
+            const OperationMode mode = stateHandler.getCurrentMode();
+            if (mode != lastMode && mode != OperationMode::PARTY) {
+                partyRenderer.reset();
+            }
+            if (mode == OperationMode::PARTY) {
+                int r, g, b;
+                partyRenderer.step(now, stateHandler.getPartyHz(), r, g, b);
+                ledController.setPWMDirectly(r, g, b);
+            }
+            lastMode = mode;
+        }
+        if (now - lastHeartbeat >= 2000) {
+            lastHeartbeat = now;
+            int r, g, b;
+            ledController.getPWMValues(r, g, b);
+            logStatus("STATUS", "mode=%s rgb=%d,%d,%d frames=%u", operationModeName(stateHandler.getCurrentMode()), r,
+                      g, b, static_cast<unsigned>(serialLink.framesHandled()));
+        }
+
+        struct pollfd waitFd = {master, POLLIN, 0};
+        ::poll(&waitFd, 1, 2);
+    }
+
+    const SerialFrameReader::Errors &errors = serialLink.errors();
+    fprintf(stderr, "%u frames, %u bad CRC, %u malformed, %u overflow\n",
+            static_cast<unsigned>(serialLink.framesHandled()), static_cast<unsigned>(errors.badCrc),
+            static_cast<unsigned>(errors.malformed), static_cast<unsigned>(errors.overflow));
+    if (linkPath) {
+        unlink(linkPath);
+    }
+    close(slaveFd);
+    close(master);
+    return 0;
+}
@@ -0,0 +1,336 @@
+// Replays a trace downloaded from /api/trace through the native build of
+// LEDController, StateHandler and PartyRenderer under a virtual clock, and
+// checks that every mode transition and PWM write matches the capture.
+//
+//   make -C tools trace_replay
+//   curl -o lamp.trace http://<lamp-ip>/api/trace
+//   tools/build/trace_replay lamp.trace [--dump] [--verbose]
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <deque>
+#include <vector>
+#include "LEDController.h"
+#include "State.h"
+#include "PartyRenderer.h"
+#include "Scheduler.h"
+#include "Scenes.h"
+#include "Trace.h"
+
+struct PwmWrite {
+    int channel;
+    int duty;
+};
+
+static std::deque<PwmWrite> expectedWrites;
+
+static void captureWrite(int channel, int duty) {
+    PwmWrite write = {channel, duty};
+    expectedWrites.push_back(write);
+}
+
+// Mirrors LampCommands' latest-wins queue: queued RGB/PARTY_HZ records are
+// held until the APPLY record that shows when the device took them.
+struct QueuedCommands {
+    bool color = false;
+    uint32_t rgb = 0;
+    bool hz = false;
+    uint32_t milliHz = 0;
+    bool colorLast = false;
+};
+
+static void applyRgb(LampLEDController &ledController, StateHandler &stateHandler, uint32_t rgb) {
+    ledController.setPWMDirectly(map((rgb >> 16) & 0xFF, 0, 255, 0, 2047), map((rgb >> 8) & 0xFF, 0, 255, 0, 2047),
+                                 map(rgb & 0xFF, 0, 255, 0, 2047));
+    stateHandler.setMode(OperationMode::WIFI);
+}
+
+static void applyPartyHz(StateHandler &stateHandler, uint32_t milliHz) {
+    stateHandler.setPartyHz(milliHz / 1000.0f);
+    stateHandler.setMode(OperationMode::PARTY);
+}
+
+static const char *eventName(uint8_t event) {
+    switch (static_cast<TraceEvent>(event)) {
+    case TraceEvent::SNAPSHOT: return "SNAPSHOT";
+    case TraceEvent::SNAPSHOT_COLOR: return "SNAPSHOT_COLOR";
+    case TraceEvent::COMMAND: return "COMMAND";
+    case TraceEvent::MODE: return "MODE";
+    case TraceEvent::PWM: return "PWM";
+    case TraceEvent::TICK: return "TICK";
+    }
+    return "?";
+}
+
+static bool loadTrace(const char *path, TraceFileHeader &header, std::vector<TraceRecord> &records) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              memcmp(header.magic, "CSLT", 4) == 0 &&
+              header.version == TraceRecorder::VERSION &&
+              header.recordSize == sizeof(TraceRecord);
+    if (ok) {
+        records.resize(header.count);
+        ok = header.count == 0 || fread(records.data(), sizeof(TraceRecord), header.count, file) == header.count;
+    }
+    fclose(file);
+    if (!ok) {
+        fprintf(stderr, "%s: not a version %u trace file\n", path, TraceRecorder::VERSION);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const char *path = nullptr;
+    bool dump = false;
+    bool verbose = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dump") == 0) {
+            dump = true;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s <trace file> [--dump] [--verbose]\n", argv[0]);
+        return 2;
+    }
+
+    TraceFileHeader header;
+    std::vector<TraceRecord> records;
+    if (!loadTrace(path, header, records)) {
+        return 2;
+    }
+    printf("%u records (%u overwritten before capture)\n", header.count, header.overwritten);
+
+    if (dump) {
+        for (size_t i = 0; i < records.size(); i++) {
+            const TraceRecord &rec = records[i];
+            printf("%10u us  %-14s code=%u arg=%u value=%u\n", rec.timeUs, eventName(rec.event), rec.code, rec.arg,
+                   rec.value);
+        }
+        return 0;
+    }
+
+    // Replay starts at the first complete snapshot; earlier records have no
+    // known starting state.
+    size_t start = 0;
+    while (start + 1 < records.size() &&
+           !(records[start].event == static_cast<uint8_t>(TraceEvent::SNAPSHOT) &&
+             records[start + 1].event == static_cast<uint8_t>(TraceEvent::SNAPSHOT_COLOR))) {
+        start++;
+    }
+    if (start + 1 >= records.size()) {
+        fprintf(stderr, "no snapshot in trace; nothing to replay\n");
+        return 2;
+    }
+
+    hostSetSerialEnabled(verbose);
+    hostSetMicros(records[start].timeUs);
+
+    const TraceRecord &snap = records[start];
+    const TraceRecord &color = records[start + 1];
+    Preferences prefs;
+    prefs.begin("led", false);
+    prefs.putBool("unlocked", snap.arg != 0);
+    prefs.end();
+
+    const LedChannelConfig channelMap[3] = {{7, 0, RED_TRIM}, {6, 1, GREEN_TRIM}, {5, 2, BLUE_TRIM}};
+    LampLEDController ledController(channelMap);
+    StateHandler stateHandler(ledController);
+    PartyRenderer partyRenderer;
+    ledController.begin();
+    stateHandler.begin();
+    stateHandler.setMode(static_cast<OperationMode>(snap.code));
+    stateHandler.setPartyHz(snap.value / 1000.0f);
+    ledController.setPWMDirectly(color.arg, color.value >> 16, color.value & 0xFFFF);
+
+    // The party hue is not part of the snapshot, so party output can only be
+    // compared once replay has seen party mode start from a reset hue.
+    bool partySynced = stateHandler.getCurrentMode() != OperationMode::PARTY;
+    OperationMode lastMode = stateHandler.getCurrentMode();
+    QueuedCommands queued;
+
+    hostSetLedcWriteHook(captureWrite);
+    expectedWrites.clear();
+
+    uint64_t now = records[start].timeUs;
+    uint32_t lastStamp = records[start].timeUs;
+    size_t commands = 0, writesMatched = 0, writesSkipped = 0, divergences = 0;
+
+    for (size_t i = start + 2; i < records.size(); i++) {
+        const TraceRecord &rec = records[i];
+        now += static_cast<uint32_t>(rec.timeUs - lastStamp); // unwraps the 32-bit stamp
+        lastStamp = rec.timeUs;
+        hostSetMicros(now);
+
+        switch (static_cast<TraceEvent>(rec.event)) {
+        case TraceEvent::COMMAND:
+            commands++;
+            switch (static_cast<TraceCommand>(rec.code)) {
+            case TraceCommand::RGB:
+                if (rec.arg != 0) {
+                    queued.color = true;
+                    queued.rgb = rec.value;
+                    queued.colorLast = true;
+                } else {
+                    applyRgb(ledController, stateHandler, rec.value);
+                }
+                break;
+            case TraceCommand::MODE:
+                stateHandler.setMode(static_cast<OperationMode>(rec.arg));
+                if (stateHandler.getCurrentMode() == OperationMode::OFF) {
+                    ledController.setPWMDirectly(0, 0, 0);
+                }
+                break;
+            case TraceCommand::SCENE:
+                if (rec.arg < SCENE_COUNT) {
+                    stateHandler.setMode(OperationMode::WIFI);
+                    ledController.setPWMDirectly(SCENES[rec.arg].red, SCENES[rec.arg].green, SCENES[rec.arg].blue);
+                }
+                break;
+            case TraceCommand::PARTY_HZ:
+                if (rec.arg != 0) {
+                    queued.hz = true;
+                    queued.milliHz = rec.value;
+                    queued.colorLast = false;
+                } else {
+                    applyPartyHz(stateHandler, rec.value);
+                }
+                break;
+            case TraceCommand::APPLY:
+                if (queued.hz && queued.colorLast) {
+                    applyPartyHz(stateHandler, queued.milliHz);
+                }
+                if (queued.color) {
+                    applyRgb(ledController, stateHandler, queued.rgb);
+                }
+                if (queued.hz && !queued.colorLast) {
+                    applyPartyHz(stateHandler, queued.milliHz);
+                }
+                queued.color = false;
+                queued.hz = false;
+                break;
+            case TraceCommand::FRAME:
+                ledController.setPWMDirectly(rec.arg, rec.value >> 16, rec.value & 0xFFFF);
+                stateHandler.setMode(OperationMode::WIFI);
+                break;
+            case TraceCommand::SCHEDULE:
+                switch (static_cast<ScheduleAction>(rec.arg)) {
+                case ScheduleAction::SCENE:
+                    if (rec.value < SCENE_COUNT) {
+                        stateHandler.setMode(OperationMode::WIFI);
+                        ledController.setPWMDirectly(SCENES[rec.value].red, SCENES[rec.value].green,
+                                                     SCENES[rec.value].blue);
+                    }
+                    break;
+                case ScheduleAction::MODE:
+                    stateHandler.setMode(static_cast<OperationMode>(rec.value));
+                    if (stateHandler.getCurrentMode() == OperationMode::OFF) {
+                        ledController.setPWMDirectly(0, 0, 0);
+                    }
+                    break;
+                case ScheduleAction::PARTY:
+                    stateHandler.setPartyHz(rec.value / 1000.0f);
+                    stateHandler.setMode(OperationMode::PARTY);
+                    break;
+                case ScheduleAction::FADE:
+                    // The steps follow as FADE records.
+                    stateHandler.setMode(OperationMode::WIFI);
+                    break;
+                }
+                break;
+            case TraceCommand::FADE:
+                ledController.setPWMDirectly(rec.arg, rec.value >> 16, rec.value & 0xFFFF);
+                break;
+            case TraceCommand::UNLOCK:
+                ledController.unlock();
+                ledController.checkAndUpdatePowerLimit();
+                break;
+            case TraceCommand::RESET:
+                ledController.resetToSafeMode();
+                ledController.checkAndUpdatePowerLimit();
+                break;
+            }
+            break;
+
+        case TraceEvent::TICK:
+            if (stateHandler.getCurrentMode() == OperationMode::PARTY) {
+                int r, g, b;
+                partyRenderer.step(rec.value, stateHandler.getPartyHz(), r, g, b);
+                ledController.setPWMDirectly(r, g, b);
+            }
+            break;
+
+        case TraceEvent::MODE:
+            if (static_cast<uint8_t>(stateHandler.getCurrentMode()) != rec.code) {
+                printf("divergence at %u us: device entered mode %u, replay is in mode %u\n", rec.timeUs, rec.code,
+                       static_cast<unsigned>(stateHandler.getCurrentMode()));
+                divergences++;
+            }
+            break;
+
+        case TraceEvent::PWM: {
+            if (!partySynced && stateHandler.getCurrentMode() == OperationMode::PARTY) {
+                writesSkipped++;
+                expectedWrites.clear();
+                break;
+            }
+            if (expectedWrites.empty()) {
+                printf("divergence at %u us: device wrote ch%u=%u, replay wrote nothing\n", rec.timeUs, rec.code,
+                       rec.value);
+                divergences++;
+                break;
+            }
+            PwmWrite write = expectedWrites.front();
+            expectedWrites.pop_front();
+            if (write.channel != rec.code || write.duty != static_cast<int>(rec.value)) {
+                printf("divergence at %u us: device wrote ch%u=%u, replay wrote ch%d=%d\n", rec.timeUs, rec.code,
+                       rec.value, write.channel, write.duty);
+                divergences++;
+            } else {
+                writesMatched++;
+            }
+            break;
+        }
+
+        case TraceEvent::SNAPSHOT:
+            if (static_cast<uint8_t>(stateHandler.getCurrentMode()) != rec.code) {
+                printf("divergence at %u us: snapshot mode %u, replay mode %u\n", rec.timeUs, rec.code,
+                       static_cast<unsigned>(stateHandler.getCurrentMode()));
+                divergences++;
+            }
+            break;
+
+        case TraceEvent::SNAPSHOT_COLOR:
+            break;
+        }
+
+        // Mirror loop(): leaving party mode resets the effect.
+        OperationMode mode = stateHandler.getCurrentMode();
+        if (mode != lastMode) {
+            if (mode != OperationMode::PARTY) {
+                partyRenderer.reset();
+            } else if (lastMode != OperationMode::PARTY) {
+                partySynced = true;
+            }
+            lastMode = mode;
+        }
+    }
+
+    if (!expectedWrites.empty()) {
+        printf("divergence: replay produced %u writes the device never made\n",
+               static_cast<unsigned>(expectedWrites.size()));
+        divergences++;
+    }
+
+    printf("replayed %u commands: %u PWM writes matched, %u skipped (party hue unsynced), %u divergences\n",
+           static_cast<unsigned>(commands), static_cast<unsigned>(writesMatched),
+           static_cast<unsigned>(writesSkipped), static_cast<unsigned>(divergences));
+    return divergences == 0 ? 0 : 1;
+}